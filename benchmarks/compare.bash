@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Compare execution engines by dispatch count and wall-clock execution time.
+# Command format: ./benchmarks/compare.bash [files...]
+#   CODE=path/to/code   interpreter binary (default: ./code)
+#   ENGINES="a b ..."   engines to run (default: visitor vm regvm closure)
+# Every engine's output is checked against the first engine listed.
+
+CODE=${CODE:-./code}
+ENGINES=${ENGINES:-"visitor vm regvm closure"}
+if [ $# -eq 0 ]; then
+    set -- benchmarks/*.in testcases/basic-testcases/*.in
+fi
+
+if [ ! -x "$CODE" ]; then
+    echo "Error: interpreter $CODE not found, build it first or set CODE."
+    exit 1
+fi
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+printf "%-40s %-10s %14s %12s  %s\n" "file" "engine" "dispatches" "time_ms" "output"
+for f in "$@"; do
+    ref=""
+    for e in $ENGINES; do
+        "$CODE" --engine="$e" --stats < "$f" > "$tmp/$e.out" 2> "$tmp/$e.err"
+        stats=$(grep '^engine=' "$tmp/$e.err" | tail -1)
+        dispatches=$(sed -n 's/.*dispatches=\([0-9]*\).*/\1/p' <<< "$stats")
+        ms=$(sed -n 's/.*time_ms=\([0-9.]*\).*/\1/p' <<< "$stats")
+        if [ -z "$ref" ]; then
+            ref=$e
+            verdict="reference"
+        elif cmp -s "$tmp/$ref.out" "$tmp/$e.out"; then
+            verdict="same"
+        else
+            verdict="DIFFERS"
+        fi
+        printf "%-40s %-10s %14s %12s  %s\n" "$(basename "$f")" "$e" "${dispatches:--}" "${ms:--}" "$verdict"
+    done
+done
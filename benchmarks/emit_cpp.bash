@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Check the --emit-cpp translation: every program is translated, built against
+# the runtime in src/ and run, and its output is compared with the .out file
+# next to it (or, when there is none, with the register VM's output).
+# Command format: ./benchmarks/emit_cpp.bash [files...]
+#   CODE=path/to/code   interpreter binary (default: ./code)
+#   CXX=compiler        C++ compiler (default: g++)
+
+CODE=${CODE:-./code}
+CXX=${CXX:-g++}
+SRC=$(cd "$(dirname "$0")/../src" && pwd)
+if [ $# -eq 0 ]; then
+    set -- testcases/*/*.in benchmarks/*.in
+fi
+
+if [ ! -x "$CODE" ]; then
+    echo "Error: interpreter $CODE not found, build it first or set CODE."
+    exit 1
+fi
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# the runtime is the same for every program
+for unit in Value Output Frames; do
+    "$CXX" -std=c++17 -O2 -I"$SRC" -c "$SRC/$unit.cpp" -o "$tmp/$unit.o" || exit 1
+done
+
+now() { date +%s%N; }
+
+failed=0
+printf "%-40s %12s %12s  %s\n" "file" "regvm_ms" "native_ms" "output"
+for f in "$@"; do
+    name=$(basename "$f")
+    if ! "$CODE" --emit-cpp < "$f" > "$tmp/prog.cpp" 2> "$tmp/emit.err"; then
+        printf "%-40s %12s %12s  %s\n" "$name" - - "EMIT FAILED: $(head -1 "$tmp/emit.err")"
+        failed=1
+        continue
+    fi
+    if ! "$CXX" -std=c++17 -O2 -I"$SRC" "$tmp/prog.cpp" "$tmp/Value.o" "$tmp/Output.o" "$tmp/Frames.o" -pthread \
+            -o "$tmp/prog" 2> "$tmp/build.err"; then
+        printf "%-40s %12s %12s  %s\n" "$name" - - "BUILD FAILED: $(head -1 "$tmp/build.err")"
+        failed=1
+        continue
+    fi
+    start=$(now)
+    "$CODE" --engine=regvm < "$f" > "$tmp/regvm.out" 2> /dev/null
+    regvm=$(( ($(now) - start) / 1000000 ))
+    start=$(now)
+    "$tmp/prog" > "$tmp/native.out" 2> /dev/null
+    native=$(( ($(now) - start) / 1000000 ))
+    expected="${f%.in}.out"
+    [ -f "$expected" ] || expected="$tmp/regvm.out"
+    if cmp -s "$expected" "$tmp/native.out"; then
+        verdict="same"
+    else
+        verdict="DIFFERS"
+        failed=1
+    fi
+    printf "%-40s %12s %12s  %s\n" "$name" "$regvm" "$native" "$verdict"
+done
+exit $failed
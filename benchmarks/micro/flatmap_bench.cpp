@@ -0,0 +1,61 @@
+// Lookup microbenchmark: the old node-based global environment
+// (std::unordered_map<std::string, Value>) against AtomMap keyed by interned atoms.
+// Build with -DPY_BUILD_BENCHMARKS=ON and run ./flatmap_bench [names] [lookups].
+#include <bits/stdc++.h>
+#include "FlatMap.h"
+
+template <class F> static double timeMs(F &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    size_t numNames = argc > 1 ? std::stoul(argv[1]) : 48;
+    size_t lookups = argc > 2 ? std::stoul(argv[2]) : 20000000;
+
+    // identifiers shaped like the testcases' (x, ret, cnt, quick_power, ...)
+    std::vector<std::string> names;
+    for (size_t i = 0; i < numNames; ++i) names.push_back((i % 3 ? "v" : "loop_counter_") + std::to_string(i));
+    std::mt19937 rng(2024);
+    std::vector<uint32_t> order(lookups);
+    for (auto &o : order) o = rng() % numNames;
+
+    std::unordered_map<std::string, Value> nodeMap;
+    AtomTable atoms;
+    AtomMap<Value> flatMap;
+    std::vector<Atom> atomOf;
+    for (size_t i = 0; i < numNames; ++i) {
+        nodeMap[names[i]] = Value::fromInt(BigInt::fromLL(i));
+        atomOf.push_back(atoms.intern(names[i]));
+        flatMap[atomOf.back()] = Value::fromInt(BigInt::fromLL(i));
+    }
+
+    long long sink = 0;
+    // what the visitor used to do per read: copy the token text, then hash it
+    double textMs = timeMs([&] {
+        for (uint32_t o : order) {
+            std::string key = names[o];
+            sink += nodeMap.find(key)->second.type;
+        }
+    });
+    double nodeMs = timeMs([&] {
+        for (uint32_t o : order) sink += nodeMap.find(names[o])->second.type;
+    });
+    double flatMs = timeMs([&] {
+        for (uint32_t o : order) sink += flatMap.at(flatMap.find(atomOf[o])).type;
+    });
+    double internMs = timeMs([&] {
+        for (uint32_t o : order) sink += atoms.intern(names[o]);
+    });
+
+    auto row = [&](const char *what, double ms) {
+        std::printf("%-44s %10.1f ms %8.2f ns/lookup\n", what, ms, ms * 1e6 / double(lookups));
+    };
+    std::printf("%zu names, %zu lookups (checksum %lld)\n", numNames, lookups, sink);
+    row("unordered_map<string> (copy token text)", textMs);
+    row("unordered_map<string>", nodeMs);
+    row("AtomMap<Value> by atom", flatMs);
+    row("AtomTable::intern (parse-time cost)", internMs);
+    return 0;
+}
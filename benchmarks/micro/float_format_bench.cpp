@@ -0,0 +1,110 @@
+// Float formatting microbenchmark and agreement check: formatFloat (the
+// std::to_chars formatter behind print, str() and f-strings) against the
+// ostringstream Value::toString used to build and against snprintf("%.6f").
+// Every checked value must format exactly as the ostringstream did; the
+// program exits with status 1 on the first mismatches.
+// Build with -DPY_BUILD_BENCHMARKS=ON and run ./float_format_bench [values].
+#include <bits/stdc++.h>
+#include "Value.h"
+
+template <class F> static double timeMs(F &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// what Value::toString printed before formatFloat
+static std::string streamed(double x) {
+    std::ostringstream oss; oss.setf(std::ios::fixed); oss<<std::setprecision(6)<<x; return oss.str();
+}
+
+static size_t checked = 0, mismatches = 0;
+
+static void check(double x) {
+    ++checked;
+    char buf[kFloatChars];
+    std::string_view got(buf, size_t(formatFloat(x, buf) - buf));
+    std::string want = streamed(x);
+    if (got == want) return;
+    if (++mismatches <= 10)
+        std::printf("MISMATCH %a: formatFloat \"%.*s\", ostringstream \"%s\"\n", x, int(got.size()), got.data(), want.c_str());
+}
+
+int main(int argc, char *argv[]) {
+    size_t values = argc > 1 ? std::stoul(argv[1]) : 2000000;
+    std::mt19937_64 rng(2024);
+
+    // specials and the extremes of the range
+    const double inf = std::numeric_limits<double>::infinity(), nan = std::numeric_limits<double>::quiet_NaN();
+    for (double x : {0.0, -0.0, inf, -inf, nan, -nan, std::numeric_limits<double>::max(),
+                     std::numeric_limits<double>::min(), std::numeric_limits<double>::denorm_min()}) {
+        check(x);
+        check(-x);
+    }
+    // powers of ten and their neighbours, where the rounding digit is 9 or 0
+    for (int e = -30; e <= 308; ++e) {
+        double p = std::pow(10.0, e);
+        for (double x : {p, std::nextafter(p, 0.0), std::nextafter(p, inf), p / 2, p * 5e-7}) {
+            check(x);
+            check(-x);
+        }
+    }
+    // every multiple of 2^-m below 2^20 / 2^m for m = 7..12: the seventh decimal
+    // is 5 with nothing after it for odd multiples, so these are the exact ties
+    for (int m = 7; m <= 12; ++m)
+        for (long long k = 0; k < (1 << 20); ++k) check(std::ldexp(double(k), -m));
+    // the integers and the hundredths, as the testcases mostly print
+    for (long long k = -1000000; k <= 1000000; ++k) {
+        check(double(k));
+        check(double(k) / 100);
+    }
+    // every 97th float, through the whole single-precision range
+    for (uint64_t bits = 0; bits <= 0xffffffffu; bits += 97) {
+        float f;
+        uint32_t b = uint32_t(bits);
+        std::memcpy(&f, &b, sizeof f);
+        check(double(f));
+    }
+    // uniform doubles, and uniform bit patterns (mostly huge or tiny magnitudes)
+    std::uniform_real_distribution<double> unit(-1e6, 1e6);
+    for (size_t i = 0; i < 2000000; ++i) {
+        check(unit(rng));
+        uint64_t bits = rng();
+        double x;
+        std::memcpy(&x, &bits, sizeof x);
+        check(x);
+    }
+    std::printf("%zu values checked, %zu mismatches\n", checked, mismatches);
+    if (mismatches) return 1;
+
+    // timing inputs: the magnitudes programs print
+    std::vector<double> xs(values);
+    std::uniform_real_distribution<double> magnitude(-3, 9);
+    for (auto &x : xs) x = std::pow(10.0, magnitude(rng)) * (rng() & 1 ? 1 : -1);
+
+    size_t sink = 0;
+    double streamMs = timeMs([&] {
+        for (double x : xs) sink += streamed(x).size();
+    });
+    double printfMs = timeMs([&] {
+        char buf[kFloatChars];
+        for (double x : xs) sink += size_t(std::snprintf(buf, sizeof buf, "%.6f", x));
+    });
+    double formatMs = timeMs([&] {
+        char buf[kFloatChars];
+        for (double x : xs) sink += size_t(formatFloat(x, buf) - buf);
+    });
+    double toStringMs = timeMs([&] {
+        for (double x : xs) sink += Value::fromFloat(x).toString().size();
+    });
+
+    auto row = [&](const char *what, double ms) {
+        std::printf("%-44s %10.1f ms %8.2f ns/value\n", what, ms, ms * 1e6 / double(values));
+    };
+    std::printf("%zu values (checksum %zu)\n", values, sink);
+    row("ostringstream, fixed, setprecision(6)", streamMs);
+    row("snprintf %.6f", printfMs);
+    row("formatFloat into a buffer", formatMs);
+    row("Value::toString", toStringMs);
+    return 0;
+}
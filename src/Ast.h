@@ -0,0 +1,187 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_AST_H
+#define PYTHON_INTERPRETER_AST_H
+
+#include <bits/stdc++.h>
+#include "Value.h"
+
+// Compact typed AST produced once from the ANTLR parse tree (see AstBuilder).
+// Single-child rule chains (test -> or_test -> ... -> atom) are collapsed and
+// operator tokens are resolved to enums, so engines never touch *Context objects.
+namespace ast {
+
+// Bump allocator owning every node; destructors of non-trivial nodes are recorded
+// so that the whole tree is released in one go.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena() {
+        for (auto it = dtors.rbegin(); it != dtors.rend(); ++it) it->second(it->first);
+    }
+
+    void *allocate(size_t size, size_t align) {
+        size_t p = (used + align - 1) & ~(align - 1);
+        if (blocks.empty() || p + size > blockSize) {
+            blockSize = std::max(size, kBlock);
+            blocks.emplace_back(new char[blockSize]); // aligned for any node type
+            reserved += blockSize; p = 0;
+        }
+        used = p + size;
+        bytes += size;
+        return blocks.back().get() + p;
+    }
+    template <class T, class... Args> T *make(Args &&...args) {
+        T *p = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            dtors.emplace_back(p, [](void *q) { static_cast<T *>(q)->~T(); });
+        return p;
+    }
+    std::string_view copy(const std::string &s) {
+        char *p = static_cast<char *>(allocate(s.size() + 1, 1));
+        std::memcpy(p, s.c_str(), s.size() + 1);
+        return {p, s.size()};
+    }
+
+    size_t bytesUsed() const { return bytes; }
+    size_t bytesReserved() const { return reserved; }
+
+private:
+    static const size_t kBlock = 8 * 1024;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<std::pair<void *, void (*)(void *)>> dtors;
+    size_t blockSize = 0, used = 0, bytes = 0, reserved = 0;
+};
+
+// Fixed-size array living in the arena.
+template <class T> struct Span {
+    T *data = nullptr;
+    uint32_t size = 0;
+    T *begin() const { return data; }
+    T *end() const { return data + size; }
+    T &operator[](size_t i) const { return data[i]; }
+    bool empty() const { return size == 0; }
+};
+
+using ::BinOp;
+using ::CmpOp;
+
+struct Expr {
+    enum Kind : uint8_t { Const, Name, Neg, Not, Binary, Compare, And, Or, Call, FString, Tuple } kind;
+    explicit Expr(Kind k) : kind(k) {}
+};
+
+struct ConstExpr : Expr {
+    Value value;
+    explicit ConstExpr(Value v) : Expr(Const), value(std::move(v)) {}
+};
+struct NameExpr : Expr {
+    std::string_view id;
+    explicit NameExpr(std::string_view n) : Expr(Name), id(n) {}
+};
+// Neg / Not
+struct UnaryExpr : Expr {
+    Expr *operand;
+    UnaryExpr(Kind k, Expr *e) : Expr(k), operand(e) {}
+};
+struct BinaryExpr : Expr {
+    BinOp op;
+    Expr *lhs, *rhs;
+    BinaryExpr(BinOp o, Expr *l, Expr *r) : Expr(Binary), op(o), lhs(l), rhs(r) {}
+};
+// a op0 b op1 c ... ; operands.size == ops.size + 1
+struct CompareExpr : Expr {
+    Span<Expr *> operands;
+    Span<CmpOp> ops;
+    CompareExpr() : Expr(Compare) {}
+};
+// And / Or over two or more operands
+struct LogicExpr : Expr {
+    Span<Expr *> operands;
+    explicit LogicExpr(Kind k) : Expr(k) {}
+};
+struct Argument {
+    std::string_view keyword; // empty for positional arguments
+    Expr *value;
+};
+struct CallExpr : Expr {
+    std::string_view callee;
+    Span<Argument> args;
+    CallExpr() : Expr(Call) {}
+};
+// f-string: literal pieces and expression slots in source order
+struct FStringPart {
+    std::string_view literal; // used when expr == nullptr
+    Expr *expr;
+};
+struct FStringExpr : Expr {
+    Span<FStringPart> parts;
+    FStringExpr() : Expr(FString) {}
+};
+struct TupleExpr : Expr {
+    Span<Expr *> elems;
+    TupleExpr() : Expr(Tuple) {}
+};
+
+struct Stmt {
+    enum Kind : uint8_t { ExprS, Assign, AugAssign, If, While, Break, Continue, Return, FuncDef } kind;
+    explicit Stmt(Kind k) : kind(k) {}
+};
+using Block = Span<Stmt *>;
+
+struct ExprStmt : Stmt {
+    Expr *expr;
+    explicit ExprStmt(Expr *e) : Stmt(ExprS), expr(e) {}
+};
+// t1 = t2 = ... = value ; each target list is one or more names (a, b = ...)
+struct AssignStmt : Stmt {
+    Span<Span<std::string_view>> targets;
+    Expr *value;
+    AssignStmt() : Stmt(Assign), value(nullptr) {}
+};
+struct AugAssignStmt : Stmt {
+    std::string_view target;
+    BinOp op;
+    Expr *value;
+    AugAssignStmt(std::string_view t, BinOp o, Expr *v) : Stmt(AugAssign), target(t), op(o), value(v) {}
+};
+struct IfBranch {
+    Expr *cond;
+    Block body;
+};
+struct IfStmt : Stmt {
+    Span<IfBranch> branches;
+    Block orelse;
+    IfStmt() : Stmt(If) {}
+};
+struct WhileStmt : Stmt {
+    Expr *cond;
+    Block body;
+    WhileStmt(Expr *c, Block b) : Stmt(While), cond(c), body(b) {}
+};
+struct ReturnStmt : Stmt {
+    Expr *value; // nullptr for a bare return
+    explicit ReturnStmt(Expr *v) : Stmt(Return), value(v) {}
+};
+struct Param {
+    std::string_view name;
+    Expr *defaultValue; // nullptr when the parameter has no default
+};
+struct FuncDefStmt : Stmt {
+    std::string_view name;
+    Span<Param> params;
+    Block body;
+    FuncDefStmt() : Stmt(FuncDef) {}
+};
+
+// Owns the lowered program; the ANTLR tree can be released once this exists.
+struct Program {
+    Arena arena;
+    Block body;
+    size_t nodeCount = 0;
+};
+
+} // namespace ast
+
+#endif//PYTHON_INTERPRETER_AST_H
@@ -0,0 +1,306 @@
+#include "AstBuilder.h"
+
+using namespace ast;
+
+template <class T> Span<T> AstBuilder::span(const std::vector<T> &v) {
+    Span<T> s;
+    if (v.empty()) return s;
+    s.data = static_cast<T *>(prog.arena.allocate(sizeof(T) * v.size(), alignof(T)));
+    s.size = uint32_t(v.size());
+    std::uninitialized_copy(v.begin(), v.end(), s.data);
+    return s;
+}
+
+static std::string tokenText(antlr4::tree::TerminalNode *node) { return node->getSymbol()->getText(); }
+
+// Descend a single-child chain (test -> ... -> atom) and return the NAME at its end.
+static antlr4::tree::TerminalNode *chainName(antlr4::tree::ParseTree *t) {
+    while (t->children.size() == 1) t = t->children[0];
+    auto *term = dynamic_cast<antlr4::tree::TerminalNode *>(t);
+    if (term && term->getSymbol()->getType() == Python3Parser::NAME) return term;
+    return nullptr;
+}
+
+void AstBuilder::build(Python3Parser::File_inputContext *ctx) {
+    std::vector<Stmt *> body;
+    for (auto s : ctx->stmt()) stmt(s, body);
+    prog.body = span(body);
+}
+
+// Statements
+
+void AstBuilder::stmt(Python3Parser::StmtContext *ctx, std::vector<Stmt *> &out) {
+    if (auto simple = ctx->simple_stmt()) {
+        if (Stmt *s = smallStmt(simple->small_stmt())) out.push_back(s);
+        return;
+    }
+    auto comp = ctx->compound_stmt();
+    if (comp->if_stmt()) out.push_back(ifStmt(comp->if_stmt()));
+    else if (comp->while_stmt()) out.push_back(whileStmt(comp->while_stmt()));
+    else if (comp->funcdef()) out.push_back(funcdef(comp->funcdef()));
+}
+
+Stmt *AstBuilder::smallStmt(Python3Parser::Small_stmtContext *ctx) {
+    if (ctx->expr_stmt()) return exprStmt(ctx->expr_stmt());
+    auto flow = ctx->flow_stmt();
+    if (flow->break_stmt()) return make<Stmt>(Stmt::Break);
+    if (flow->continue_stmt()) return make<Stmt>(Stmt::Continue);
+    auto ret = flow->return_stmt();
+    return make<ReturnStmt>(ret->testlist() ? testlist(ret->testlist()) : nullptr);
+}
+
+std::vector<std::string_view> AstBuilder::targetNames(Python3Parser::TestlistContext *ctx) {
+    std::vector<std::string_view> names;
+    for (auto t : ctx->test()) {
+        auto name = chainName(t);
+        if (!name) throw std::runtime_error("unsupported assignment target: " + t->getText());
+        names.push_back(prog.arena.copy(tokenText(name)));
+    }
+    return names;
+}
+
+Stmt *AstBuilder::exprStmt(Python3Parser::Expr_stmtContext *ctx) {
+    auto lists = ctx->testlist();
+    if (auto op = ctx->augassign()) {
+        BinOp bop = BinOp::Add;
+        switch (op->getStart()->getType()) {
+            case Python3Parser::ADD_ASSIGN: bop = BinOp::Add; break;
+            case Python3Parser::SUB_ASSIGN: bop = BinOp::Sub; break;
+            case Python3Parser::MULT_ASSIGN: bop = BinOp::Mul; break;
+            case Python3Parser::DIV_ASSIGN: bop = BinOp::Div; break;
+            case Python3Parser::IDIV_ASSIGN: bop = BinOp::IDiv; break;
+            case Python3Parser::MOD_ASSIGN: bop = BinOp::Mod; break;
+        }
+        auto names = targetNames(lists[0]);
+        return make<AugAssignStmt>(names[0], bop, testlist(lists.back()));
+    }
+    if (lists.size() == 1) return make<ExprStmt>(testlist(lists[0]));
+    auto *as = make<AssignStmt>();
+    std::vector<Span<std::string_view>> targets;
+    for (size_t i = 0; i + 1 < lists.size(); ++i) targets.push_back(span(targetNames(lists[i])));
+    as->targets = span(targets);
+    as->value = testlist(lists.back());
+    return as;
+}
+
+Stmt *AstBuilder::ifStmt(Python3Parser::If_stmtContext *ctx) {
+    auto *s = make<IfStmt>();
+    auto tests = ctx->test();
+    auto suites = ctx->suite();
+    std::vector<IfBranch> branches;
+    for (size_t i = 0; i < tests.size(); ++i) branches.push_back({test(tests[i]), suite(suites[i])});
+    s->branches = span(branches);
+    if (ctx->ELSE()) s->orelse = suite(suites.back());
+    return s;
+}
+
+Stmt *AstBuilder::whileStmt(Python3Parser::While_stmtContext *ctx) {
+    return make<WhileStmt>(test(ctx->test()), suite(ctx->suite()));
+}
+
+Stmt *AstBuilder::funcdef(Python3Parser::FuncdefContext *ctx) {
+    auto *f = make<FuncDefStmt>();
+    f->name = prog.arena.copy(tokenText(ctx->NAME()));
+    std::vector<Param> params;
+    if (auto args = ctx->parameters()->typedargslist()) {
+        // children: tfpdef ('=' test)? (',' tfpdef ('=' test)?)*
+        for (auto child : args->children) {
+            if (auto p = dynamic_cast<Python3Parser::TfpdefContext *>(child))
+                params.push_back({prog.arena.copy(tokenText(p->NAME())), nullptr});
+            else if (auto t = dynamic_cast<Python3Parser::TestContext *>(child))
+                params.back().defaultValue = test(t);
+        }
+    }
+    f->params = span(params);
+    f->body = suite(ctx->suite());
+    return f;
+}
+
+Block AstBuilder::suite(Python3Parser::SuiteContext *ctx) {
+    std::vector<Stmt *> body;
+    if (auto simple = ctx->simple_stmt()) {
+        if (Stmt *s = smallStmt(simple->small_stmt())) body.push_back(s);
+    } else {
+        for (auto s : ctx->stmt()) stmt(s, body);
+    }
+    return span(body);
+}
+
+// Expressions
+
+Expr *AstBuilder::testlist(Python3Parser::TestlistContext *ctx) {
+    auto tests = ctx->test();
+    if (tests.size() == 1) return test(tests[0]);
+    auto *t = make<TupleExpr>();
+    std::vector<Expr *> elems;
+    for (auto e : tests) elems.push_back(test(e));
+    t->elems = span(elems);
+    return t;
+}
+
+Expr *AstBuilder::test(Python3Parser::TestContext *ctx) { return orTest(ctx->or_test()); }
+
+Expr *AstBuilder::orTest(Python3Parser::Or_testContext *ctx) {
+    auto parts = ctx->and_test();
+    if (parts.size() == 1) return andTest(parts[0]);
+    auto *e = make<LogicExpr>(Expr::Or);
+    std::vector<Expr *> ops;
+    for (auto p : parts) ops.push_back(andTest(p));
+    e->operands = span(ops);
+    return e;
+}
+
+Expr *AstBuilder::andTest(Python3Parser::And_testContext *ctx) {
+    auto parts = ctx->not_test();
+    if (parts.size() == 1) return notTest(parts[0]);
+    auto *e = make<LogicExpr>(Expr::And);
+    std::vector<Expr *> ops;
+    for (auto p : parts) ops.push_back(notTest(p));
+    e->operands = span(ops);
+    return e;
+}
+
+Expr *AstBuilder::notTest(Python3Parser::Not_testContext *ctx) {
+    if (ctx->comparison()) return comparison(ctx->comparison());
+    return make<UnaryExpr>(Expr::Not, notTest(ctx->not_test()));
+}
+
+Expr *AstBuilder::comparison(Python3Parser::ComparisonContext *ctx) {
+    auto parts = ctx->arith_expr();
+    if (parts.size() == 1) return arithExpr(parts[0]);
+    auto *e = make<CompareExpr>();
+    std::vector<Expr *> operands;
+    std::vector<CmpOp> ops;
+    for (auto p : parts) operands.push_back(arithExpr(p));
+    for (auto op : ctx->comp_op()) {
+        switch (op->getStart()->getType()) {
+            case Python3Parser::LESS_THAN: ops.push_back(CmpOp::Lt); break;
+            case Python3Parser::GREATER_THAN: ops.push_back(CmpOp::Gt); break;
+            case Python3Parser::EQUALS: ops.push_back(CmpOp::Eq); break;
+            case Python3Parser::GT_EQ: ops.push_back(CmpOp::Ge); break;
+            case Python3Parser::LT_EQ: ops.push_back(CmpOp::Le); break;
+            default: ops.push_back(CmpOp::Ne); break;
+        }
+    }
+    e->operands = span(operands);
+    e->ops = span(ops);
+    return e;
+}
+
+Expr *AstBuilder::arithExpr(Python3Parser::Arith_exprContext *ctx) {
+    auto terms = ctx->term();
+    auto ops = ctx->addorsub_op();
+    Expr *cur = term(terms[0]);
+    for (size_t i = 1; i < terms.size(); ++i) {
+        BinOp op = ops[i - 1]->ADD() ? BinOp::Add : BinOp::Sub;
+        cur = make<BinaryExpr>(op, cur, term(terms[i]));
+    }
+    return cur;
+}
+
+Expr *AstBuilder::term(Python3Parser::TermContext *ctx) {
+    auto factors = ctx->factor();
+    auto ops = ctx->muldivmod_op();
+    Expr *cur = factor(factors[0]);
+    for (size_t i = 1; i < factors.size(); ++i) {
+        BinOp op = BinOp::Div;
+        switch (ops[i - 1]->getStart()->getType()) {
+            case Python3Parser::STAR: op = BinOp::Mul; break;
+            case Python3Parser::IDIV: op = BinOp::IDiv; break;
+            case Python3Parser::MOD: op = BinOp::Mod; break;
+            default: op = BinOp::Div; break;
+        }
+        cur = make<BinaryExpr>(op, cur, factor(factors[i]));
+    }
+    return cur;
+}
+
+Expr *AstBuilder::factor(Python3Parser::FactorContext *ctx) {
+    if (ctx->atom_expr()) return atomExpr(ctx->atom_expr());
+    Expr *operand = factor(ctx->factor());
+    if (ctx->MINUS()) return make<UnaryExpr>(Expr::Neg, operand);
+    return operand; // unary plus is the identity
+}
+
+Expr *AstBuilder::atomExpr(Python3Parser::Atom_exprContext *ctx) {
+    auto a = ctx->atom();
+    auto tr = ctx->trailer();
+    if (!tr || !a->NAME()) return atom(a);
+    auto *call = make<CallExpr>();
+    call->callee = prog.arena.copy(tokenText(a->NAME()));
+    std::vector<Argument> args;
+    if (auto al = tr->arglist()) {
+        for (auto arg : al->argument()) {
+            auto tests = arg->test();
+            if (tests.size() == 2) {
+                auto kw = chainName(tests[0]);
+                if (!kw) throw std::runtime_error("invalid keyword argument: " + tests[0]->getText());
+                args.push_back({prog.arena.copy(tokenText(kw)), test(tests[1])});
+            } else {
+                args.push_back({std::string_view(), test(tests[0])});
+            }
+        }
+    }
+    call->args = span(args);
+    return call;
+}
+
+Expr *AstBuilder::atom(Python3Parser::AtomContext *ctx) {
+    if (ctx->NAME()) return make<NameExpr>(prog.arena.copy(tokenText(ctx->NAME())));
+    if (ctx->NUMBER()) {
+        std::string s = tokenText(ctx->NUMBER());
+        if (s.find('.') != std::string::npos) return make<ConstExpr>(Value::fromFloat(std::stod(s)));
+        return make<ConstExpr>(Value::fromInt(BigInt::fromString(s)));
+    }
+    if (ctx->NONE()) return make<ConstExpr>(Value::None());
+    if (ctx->TRUE()) return make<ConstExpr>(Value::fromBool(true));
+    if (ctx->FALSE()) return make<ConstExpr>(Value::fromBool(false));
+    if (ctx->OPEN_PAREN()) return test(ctx->test());
+    if (ctx->format_string()) return formatString(ctx->format_string());
+    // adjacent string literals are concatenated
+    std::string res;
+    for (auto s : ctx->STRING()) {
+        std::string text = tokenText(s);
+        res += text.substr(1, text.size() - 2);
+    }
+    return make<ConstExpr>(Value::fromStr(res));
+}
+
+Expr *AstBuilder::formatString(Python3Parser::Format_stringContext *ctx) {
+    auto *f = make<FStringExpr>();
+    std::vector<FStringPart> parts;
+    for (auto child : ctx->children) {
+        if (auto tl = dynamic_cast<Python3Parser::TestlistContext *>(child)) {
+            parts.push_back({std::string_view(), testlist(tl)});
+            continue;
+        }
+        auto term = dynamic_cast<antlr4::tree::TerminalNode *>(child);
+        if (!term || term->getSymbol()->getType() != Python3Parser::FORMAT_STRING_LITERAL) continue;
+        std::string raw = tokenText(term), lit;
+        for (size_t i = 0; i < raw.size(); ++i) {
+            lit += raw[i];
+            if ((raw[i] == '{' || raw[i] == '}') && i + 1 < raw.size() && raw[i + 1] == raw[i]) ++i;
+        }
+        parts.push_back({prog.arena.copy(lit), nullptr});
+    }
+    f->parts = span(parts);
+    return f;
+}
+
+ParseTreeStats measureParseTree(antlr4::tree::ParseTree *tree) {
+    ParseTreeStats st;
+    std::vector<antlr4::tree::ParseTree *> stack{tree};
+    while (!stack.empty()) {
+        auto *t = stack.back();
+        stack.pop_back();
+        ++st.nodes;
+        if (dynamic_cast<antlr4::tree::TerminalNode *>(t)) {
+            st.bytes += sizeof(antlr4::tree::TerminalNodeImpl) + sizeof(antlr4::CommonToken);
+        } else {
+            st.bytes += sizeof(antlr4::ParserRuleContext);
+        }
+        st.bytes += t->children.capacity() * sizeof(void *);
+        for (auto c : t->children) stack.push_back(c);
+    }
+    return st;
+}
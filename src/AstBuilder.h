@@ -0,0 +1,57 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_ASTBUILDER_H
+#define PYTHON_INTERPRETER_ASTBUILDER_H
+
+#include <bits/stdc++.h>
+#include "Python3Parser.h"
+#include "Ast.h"
+
+// One-time lowering pass: ANTLR parse tree -> ast::Program.
+class AstBuilder {
+public:
+    explicit AstBuilder(ast::Program &program) : prog(program) {}
+    void build(Python3Parser::File_inputContext *ctx);
+
+private:
+    ast::Program &prog;
+
+    template <class T, class... Args> T *make(Args &&...args) {
+        ++prog.nodeCount;
+        return prog.arena.make<T>(std::forward<Args>(args)...);
+    }
+    template <class T> ast::Span<T> span(const std::vector<T> &v);
+
+    // Statements
+    void stmt(Python3Parser::StmtContext *ctx, std::vector<ast::Stmt *> &out);
+    ast::Stmt *smallStmt(Python3Parser::Small_stmtContext *ctx);
+    ast::Stmt *exprStmt(Python3Parser::Expr_stmtContext *ctx);
+    ast::Stmt *ifStmt(Python3Parser::If_stmtContext *ctx);
+    ast::Stmt *whileStmt(Python3Parser::While_stmtContext *ctx);
+    ast::Stmt *funcdef(Python3Parser::FuncdefContext *ctx);
+    ast::Block suite(Python3Parser::SuiteContext *ctx);
+
+    // Expressions
+    ast::Expr *testlist(Python3Parser::TestlistContext *ctx);
+    ast::Expr *test(Python3Parser::TestContext *ctx);
+    ast::Expr *orTest(Python3Parser::Or_testContext *ctx);
+    ast::Expr *andTest(Python3Parser::And_testContext *ctx);
+    ast::Expr *notTest(Python3Parser::Not_testContext *ctx);
+    ast::Expr *comparison(Python3Parser::ComparisonContext *ctx);
+    ast::Expr *arithExpr(Python3Parser::Arith_exprContext *ctx);
+    ast::Expr *term(Python3Parser::TermContext *ctx);
+    ast::Expr *factor(Python3Parser::FactorContext *ctx);
+    ast::Expr *atomExpr(Python3Parser::Atom_exprContext *ctx);
+    ast::Expr *atom(Python3Parser::AtomContext *ctx);
+    ast::Expr *formatString(Python3Parser::Format_stringContext *ctx);
+
+    std::vector<std::string_view> targetNames(Python3Parser::TestlistContext *ctx);
+};
+
+// Size of a parse tree (rule contexts, terminal nodes and their child vectors).
+struct ParseTreeStats {
+    size_t nodes = 0;
+    size_t bytes = 0;
+};
+ParseTreeStats measureParseTree(antlr4::tree::ParseTree *tree);
+
+#endif//PYTHON_INTERPRETER_ASTBUILDER_H
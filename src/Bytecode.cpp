@@ -0,0 +1,42 @@
+#include "Bytecode.h"
+
+namespace bc {
+
+const char *opName(Op op) {
+    static const char *const names[] = {
+#define BC_NAME(name) #name,
+        BC_OPCODES(BC_NAME)
+#undef BC_NAME
+    };
+    return names[int(op)];
+}
+
+void disassemble(const Chunk &chunk, std::ostream &os) {
+    const Function *fn = nullptr;
+    size_t next = 0; // bodies follow the module code in definition order
+    for (size_t pc = 0; pc < chunk.code.size(); ++pc) {
+        if (next < chunk.functions.size() && chunk.functions[next].entry == int(pc)) {
+            fn = &chunk.functions[next++];
+            os << "\nfunction " << fn->name << "(";
+            for (size_t i = 0; i < fn->params.size(); ++i) os << (i ? ", " : "") << fn->params[i];
+            os << "), " << fn->locals.size() << " locals\n";
+        }
+        const Instr &in = chunk.code[pc];
+        os << std::setw(5) << pc << "  " << std::left << std::setw(22) << opName(in.op) << std::right;
+        switch (in.op) {
+            case Op::LOAD_CONST: os << in.a << " (" << chunk.consts[in.a].toString() << ")"; break;
+            case Op::LOAD_NAME: case Op::STORE_NAME: os << in.a << " (" << chunk.names[in.a] << ")"; break;
+            case Op::LOAD_FAST: case Op::STORE_FAST: os << in.a << " (" << fn->locals[in.a] << ")"; break;
+            case Op::MAKE_FUNCTION: os << chunk.functions[in.a].name << ", defaults " << in.b; break;
+            case Op::CALL: case Op::TAIL_CALL: os << chunk.names[chunk.sites[in.a].nameIndex] << ", argc " << in.b; break;
+            case Op::JUMP: case Op::POP_JUMP_IF_FALSE:
+            case Op::JUMP_IF_FALSE_OR_POP: case Op::JUMP_IF_TRUE_OR_POP: os << "-> " << in.a; break;
+            case Op::CALL_BUILTIN: os << in.a << ", argc " << in.b; break;
+            case Op::FORMAT: os << in.a; break;
+            default: break;
+        }
+        os << '\n';
+    }
+}
+
+} // namespace bc
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_BYTECODE_H
+#define PYTHON_INTERPRETER_BYTECODE_H
+
+#include <bits/stdc++.h>
+#include "Value.h"
+
+// Linear bytecode for the stack VM (see StackVM). Every instruction pops its
+// operands from the value stack and pushes its result.
+namespace bc {
+
+#define BC_OPCODES(X)                                                          \
+    X(LOAD_CONST)          /* push consts[a] */                                \
+    X(LOAD_NAME)           /* push globals[names[a]] (None if unbound) */      \
+    X(STORE_NAME)          /* globals[names[a]] = pop */                       \
+    X(LOAD_FAST)           /* push locals[a] of the running call */            \
+    X(STORE_FAST)          /* locals[a] = pop */                               \
+    X(POP)                                                                     \
+    X(DUP)                                                                     \
+    X(ROT2)                                                                    \
+    X(ROT3)                /* a b c -> c a b */                                \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(IDIV) X(MOD)                                 \
+    X(NEG) X(NOT)                                                              \
+    X(LT) X(GT) X(EQ) X(GE) X(LE) X(NE)                                        \
+    X(JUMP)                /* pc = a */                                        \
+    X(POP_JUMP_IF_FALSE)                                                       \
+    X(JUMP_IF_FALSE_OR_POP)                                                    \
+    X(JUMP_IF_TRUE_OR_POP)                                                     \
+    X(CALL_BUILTIN)        /* a = Builtin, b = argc */                         \
+    X(FORMAT)              /* concatenate the top a values as strings */       \
+    X(MAKE_FUNCTION)       /* bind functions[a] with the top b defaults */     \
+    X(CALL)                /* call through sites[a] with the top b arguments */\
+    X(TAIL_CALL)           /* CALL reusing the current frame, then return */   \
+    X(RETURN_VALUE)        /* return pop to the caller */                      \
+    X(HALT)
+
+enum class Op : uint8_t {
+#define BC_ENUM(name) name,
+    BC_OPCODES(BC_ENUM)
+#undef BC_ENUM
+};
+
+const char *opName(Op op);
+
+struct Instr {
+    Op op;
+    int32_t a = 0, b = 0;
+};
+
+// A def. Its body is compiled after the module code, at `entry`; the
+// arguments become locals 0 .. params.size()-1 of the frame.
+struct Function {
+    std::string name;
+    int nameIndex;                   // global the def binds
+    std::vector<std::string> params;
+    std::vector<std::string> locals; // params first
+    int entry = 0;
+    int maxStack = 0;
+    bool pure = false;               // calls are memoized (--memoize)
+};
+
+// A user-function call: callee name and the keyword of each argument
+// (empty for positional ones).
+struct CallSite {
+    int nameIndex;
+    std::vector<std::string> keywords;
+};
+
+struct Chunk {
+    std::vector<Instr> code;
+    std::vector<Value> consts;
+    std::vector<std::string> names;
+    std::vector<Function> functions;
+    std::vector<CallSite> sites;
+    int maxStack = 0; // of the module code
+};
+
+void disassemble(const Chunk &chunk, std::ostream &os);
+
+} // namespace bc
+
+#endif//PYTHON_INTERPRETER_BYTECODE_H
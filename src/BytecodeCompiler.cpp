@@ -0,0 +1,305 @@
+#include "BytecodeCompiler.h"
+
+using namespace ast;
+using bc::Op;
+
+static int stackEffect(Op op, int a, int b) {
+    switch (op) {
+        case Op::LOAD_CONST: case Op::LOAD_NAME: case Op::LOAD_FAST: case Op::DUP: return 1;
+        case Op::STORE_NAME: case Op::STORE_FAST: case Op::RETURN_VALUE: case Op::POP: case Op::POP_JUMP_IF_FALSE:
+        case Op::JUMP_IF_FALSE_OR_POP: case Op::JUMP_IF_TRUE_OR_POP: return -1;
+        case Op::ADD: case Op::SUB: case Op::MUL: case Op::DIV: case Op::IDIV: case Op::MOD:
+        case Op::LT: case Op::GT: case Op::EQ: case Op::GE: case Op::LE: case Op::NE: return -1;
+        case Op::CALL_BUILTIN: case Op::CALL: return 1 - b;
+        case Op::MAKE_FUNCTION: case Op::TAIL_CALL: return -b;
+        case Op::FORMAT: return 1 - a;
+        default: return 0;
+    }
+}
+
+static Op binaryOp(BinOp op) {
+    switch (op) {
+        case BinOp::Add: return Op::ADD;
+        case BinOp::Sub: return Op::SUB;
+        case BinOp::Mul: return Op::MUL;
+        case BinOp::Div: return Op::DIV;
+        case BinOp::IDiv: return Op::IDIV;
+        case BinOp::Mod: return Op::MOD;
+    }
+    return Op::ADD;
+}
+
+static Op compareOp(CmpOp op) {
+    switch (op) {
+        case CmpOp::Lt: return Op::LT;
+        case CmpOp::Gt: return Op::GT;
+        case CmpOp::Eq: return Op::EQ;
+        case CmpOp::Ge: return Op::GE;
+        case CmpOp::Le: return Op::LE;
+        case CmpOp::Ne: return Op::NE;
+    }
+    return Op::EQ;
+}
+
+bc::Chunk BytecodeCompiler::compile(const Program &program) {
+    chunk = bc::Chunk();
+    moduleNames = moduleBindings(program.body);
+    if (memoize) memoized = pureFunctions(program.body);
+    depth = peak = 0;
+    block(program.body);
+    emit(Op::HALT);
+    chunk.maxStack = peak;
+    // function bodies follow the module code; compiling one may queue nested defs
+    for (size_t i = 0; i < pending.size(); ++i) functionBody(pending[i].first, pending[i].second);
+    pending.clear();
+    moduleNames.clear();
+    memoized.clear();
+    return std::move(chunk);
+}
+
+void BytecodeCompiler::functionBody(const FuncDefStmt *fd, int index) {
+    locals.clear();
+    for (auto id : functionLocals(fd, moduleNames)) {
+        locals.emplace(id, int(locals.size()));
+        chunk.functions[index].locals.emplace_back(id);
+    }
+    chunk.functions[index].entry = here();
+    inFunction = true;
+    depth = peak = 0;
+    block(fd->body);
+    emit(Op::LOAD_CONST, constant(Value::None()));
+    emit(Op::RETURN_VALUE);
+    chunk.functions[index].maxStack = peak;
+    inFunction = false;
+}
+
+int BytecodeCompiler::emit(Op op, int a, int b) {
+    chunk.code.push_back({op, a, b});
+    depth += stackEffect(op, a, b);
+    peak = std::max(peak, depth);
+    return here() - 1;
+}
+
+int BytecodeCompiler::name(std::string_view id) {
+    auto it = nameIndex.find(id);
+    if (it != nameIndex.end()) return it->second;
+    chunk.names.emplace_back(id);
+    return nameIndex[id] = int(chunk.names.size()) - 1;
+}
+
+int BytecodeCompiler::constant(const Value &v) {
+    chunk.consts.push_back(v);
+    return int(chunk.consts.size()) - 1;
+}
+
+void BytecodeCompiler::load(std::string_view id) {
+    auto it = inFunction ? locals.find(id) : locals.end();
+    if (it != locals.end()) emit(Op::LOAD_FAST, it->second);
+    else emit(Op::LOAD_NAME, name(id));
+}
+
+void BytecodeCompiler::store(std::string_view id) {
+    auto it = inFunction ? locals.find(id) : locals.end();
+    if (it != locals.end()) emit(Op::STORE_FAST, it->second);
+    else emit(Op::STORE_NAME, name(id));
+}
+
+void BytecodeCompiler::block(const Block &body) {
+    for (auto s : body) stmt(s);
+}
+
+void BytecodeCompiler::stmt(const Stmt *s) {
+    switch (s->kind) {
+        case Stmt::ExprS:
+            expr(static_cast<const ExprStmt *>(s)->expr);
+            emit(Op::POP);
+            break;
+        case Stmt::Assign: {
+            auto as = static_cast<const AssignStmt *>(s);
+            auto *tuple = as->value->kind == Expr::Tuple ? static_cast<const TupleExpr *>(as->value) : nullptr;
+            if (as->targets.size == 1 && as->targets[0].size > 1) {
+                // a, b = x, y: evaluate every value first, then bind left to right
+                auto &names = as->targets[0];
+                if (!tuple || tuple->elems.size != names.size)
+                    throw std::runtime_error("cannot unpack value into " + std::to_string(names.size) + " names");
+                for (auto e : tuple->elems) expr(e);
+                for (int i = int(names.size) - 1; i >= 0; --i) store(names[i]);
+                break;
+            }
+            expr(as->value);
+            for (uint32_t i = 0; i < as->targets.size; ++i) {
+                if (i + 1 < as->targets.size) emit(Op::DUP);
+                store(as->targets[i][0]);
+            }
+            break;
+        }
+        case Stmt::AugAssign: {
+            auto as = static_cast<const AugAssignStmt *>(s);
+            load(as->target);
+            expr(as->value);
+            emit(binaryOp(as->op));
+            store(as->target);
+            break;
+        }
+        case Stmt::If: {
+            auto is = static_cast<const IfStmt *>(s);
+            std::vector<int> ends;
+            for (auto &br : is->branches) {
+                expr(br.cond);
+                int skip = emit(Op::POP_JUMP_IF_FALSE);
+                block(br.body);
+                ends.push_back(emit(Op::JUMP));
+                patch(skip, here());
+            }
+            block(is->orelse);
+            for (int at : ends) patch(at, here());
+            break;
+        }
+        case Stmt::While: {
+            auto ws = static_cast<const WhileStmt *>(s);
+            loops.push_back({here(), {}});
+            expr(ws->cond);
+            int exit = emit(Op::POP_JUMP_IF_FALSE);
+            block(ws->body);
+            emit(Op::JUMP, loops.back().start);
+            patch(exit, here());
+            for (int at : loops.back().breaks) patch(at, here());
+            loops.pop_back();
+            break;
+        }
+        case Stmt::Break:
+            if (!loops.empty()) loops.back().breaks.push_back(emit(Op::JUMP));
+            break;
+        case Stmt::Continue:
+            if (!loops.empty()) emit(Op::JUMP, loops.back().start);
+            break;
+        case Stmt::Return: {
+            if (!inFunction) {
+                emit(Op::HALT); // a module-level return ends the program
+                break;
+            }
+            auto rs = static_cast<const ReturnStmt *>(s);
+            if (tailCalls && rs->value && rs->value->kind == Expr::Call &&
+                builtinByName(static_cast<const CallExpr *>(rs->value)->callee) == Builtin::None) {
+                call(static_cast<const CallExpr *>(rs->value), true);
+                break;
+            }
+            if (rs->value) expr(rs->value);
+            else emit(Op::LOAD_CONST, constant(Value::None()));
+            emit(Op::RETURN_VALUE);
+            break;
+        }
+        case Stmt::FuncDef: {
+            auto fd = static_cast<const FuncDefStmt *>(s);
+            bc::Function fn;
+            fn.name = std::string(fd->name);
+            fn.nameIndex = name(fd->name);
+            fn.pure = memoized.count(fd->name) > 0;
+            int defaults = 0;
+            for (auto &p : fd->params) {
+                fn.params.emplace_back(p.name);
+                if (p.defaultValue) expr(p.defaultValue), ++defaults;
+            }
+            chunk.functions.push_back(std::move(fn));
+            pending.emplace_back(fd, int(chunk.functions.size()) - 1);
+            emit(Op::MAKE_FUNCTION, int(chunk.functions.size()) - 1, defaults);
+            break;
+        }
+    }
+}
+
+void BytecodeCompiler::expr(const Expr *e) {
+    switch (e->kind) {
+        case Expr::Const:
+            emit(Op::LOAD_CONST, constant(static_cast<const ConstExpr *>(e)->value));
+            break;
+        case Expr::Name:
+            load(static_cast<const NameExpr *>(e)->id);
+            break;
+        case Expr::Neg:
+            expr(static_cast<const UnaryExpr *>(e)->operand);
+            emit(Op::NEG);
+            break;
+        case Expr::Not:
+            expr(static_cast<const UnaryExpr *>(e)->operand);
+            emit(Op::NOT);
+            break;
+        case Expr::Binary: {
+            auto be = static_cast<const BinaryExpr *>(e);
+            expr(be->lhs);
+            expr(be->rhs);
+            emit(binaryOp(be->op));
+            break;
+        }
+        case Expr::Compare:
+            compare(static_cast<const CompareExpr *>(e));
+            break;
+        case Expr::And:
+        case Expr::Or: {
+            auto le = static_cast<const LogicExpr *>(e);
+            Op jump = e->kind == Expr::And ? Op::JUMP_IF_FALSE_OR_POP : Op::JUMP_IF_TRUE_OR_POP;
+            std::vector<int> ends;
+            for (uint32_t i = 0; i < le->operands.size; ++i) {
+                expr(le->operands[i]);
+                if (i + 1 < le->operands.size) ends.push_back(emit(jump));
+            }
+            for (int at : ends) patch(at, here());
+            break;
+        }
+        case Expr::Call:
+            call(static_cast<const CallExpr *>(e));
+            break;
+        case Expr::FString: {
+            auto fs = static_cast<const FStringExpr *>(e);
+            for (auto &part : fs->parts) {
+                if (part.expr) expr(part.expr);
+                else emit(Op::LOAD_CONST, constant(Value::fromStr(std::string(part.literal))));
+            }
+            emit(Op::FORMAT, int(fs->parts.size));
+            break;
+        }
+        case Expr::Tuple:
+            // tuple values are not first-class yet; like the visitor, keep the first element
+            expr(static_cast<const TupleExpr *>(e)->elems[0]);
+            break;
+    }
+}
+
+// a < b < c evaluates every operand at most once and stops at the first false link.
+void BytecodeCompiler::compare(const CompareExpr *e) {
+    uint32_t n = e->operands.size;
+    expr(e->operands[0]);
+    std::vector<int> cleanups;
+    for (uint32_t i = 0; i + 1 < n; ++i) {
+        expr(e->operands[i + 1]);
+        if (i + 2 < n) {
+            emit(Op::DUP);
+            emit(Op::ROT3);
+            emit(compareOp(e->ops[i]));
+            cleanups.push_back(emit(Op::JUMP_IF_FALSE_OR_POP));
+        } else {
+            emit(compareOp(e->ops[i]));
+        }
+    }
+    if (cleanups.empty()) return;
+    int end = emit(Op::JUMP);
+    for (int at : cleanups) patch(at, here());
+    ++depth; // the pending operand is still below the false result here
+    emit(Op::ROT2);
+    emit(Op::POP);
+    patch(end, here());
+}
+
+void BytecodeCompiler::call(const CallExpr *e, bool tail) {
+    for (auto &arg : e->args) expr(arg.value);
+    Builtin fn = builtinByName(e->callee);
+    if (fn != Builtin::None) {
+        emit(Op::CALL_BUILTIN, int(fn), int(e->args.size));
+        return;
+    }
+    bc::CallSite site;
+    site.nameIndex = name(e->callee);
+    for (auto &arg : e->args) site.keywords.emplace_back(arg.keyword);
+    chunk.sites.push_back(std::move(site));
+    emit(tail ? Op::TAIL_CALL : Op::CALL, int(chunk.sites.size()) - 1, int(e->args.size));
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_BYTECODECOMPILER_H
+#define PYTHON_INTERPRETER_BYTECODECOMPILER_H
+
+#include <bits/stdc++.h>
+#include "Ast.h"
+#include "Bytecode.h"
+#include "Scope.h"
+
+// Compiles an ast::Program into a bc::Chunk for the stack VM.
+class BytecodeCompiler {
+public:
+    // `return f(...)` in a def reuses the caller's frame (--no-tail-calls clears it)
+    bool tailCalls = true;
+    // memoize calls to the defs ast::pureFunctions proves pure (--memoize)
+    bool memoize = false;
+
+    bc::Chunk compile(const ast::Program &program);
+
+private:
+    struct Loop {
+        int start;
+        std::vector<int> breaks;
+    };
+
+    bc::Chunk chunk;
+    std::unordered_map<std::string_view, int> nameIndex;
+    std::vector<Loop> loops;
+    int depth = 0, peak = 0; // stack depth of the code being compiled
+    ast::NameSet moduleNames;
+    ast::NameSet memoized; // pure defs, when memoizing
+    // defs whose bodies are still to be compiled, with their function index
+    std::vector<std::pair<const ast::FuncDefStmt *, int>> pending;
+    std::unordered_map<std::string_view, int> locals; // of the def being compiled
+    bool inFunction = false;
+
+    int emit(bc::Op op, int a = 0, int b = 0);
+    int here() const { return int(chunk.code.size()); }
+    void patch(int at, int target) { chunk.code[at].a = target; }
+    int name(std::string_view id);
+    int constant(const Value &v);
+    void load(std::string_view id);
+    void store(std::string_view id);
+    void functionBody(const ast::FuncDefStmt *fd, int index);
+
+    void block(const ast::Block &body);
+    void stmt(const ast::Stmt *s);
+    void expr(const ast::Expr *e);
+    void compare(const ast::CompareExpr *e);
+    void call(const ast::CallExpr *e, bool tail = false);
+};
+
+#endif//PYTHON_INTERPRETER_BYTECODECOMPILER_H
@@ -0,0 +1,428 @@
+#include "ClosureEngine.h"
+
+using namespace ast;
+using ExprFn = ClosureEngine::ExprFn;
+using StmtFn = ClosureEngine::StmtFn;
+using Flow = ClosureEngine::Flow;
+
+using BinaryFn = Value (*)(const Value &, const Value &);
+
+static BinaryFn binaryFn(BinOp op) {
+    switch (op) {
+        case BinOp::Add: return VAdd;
+        case BinOp::Sub: return VSub;
+        case BinOp::Mul: return VMul;
+        case BinOp::Div: return VDivFloat;
+        case BinOp::IDiv: return VDivInt;
+        case BinOp::Mod: return VMod;
+    }
+    return VAdd;
+}
+
+// One closure type per operator so the call inside is direct, not through a pointer.
+template <BinaryFn Fn> static ExprFn bindBinary(uint64_t *count, ExprFn l, ExprFn r) {
+    return [count, l = std::move(l), r = std::move(r)] {
+        ++*count;
+        Value a = l();
+        return Fn(a, r());
+    };
+}
+
+template <CmpOp Op> static ExprFn bindCompare(uint64_t *count, ExprFn l, ExprFn r) {
+    return [count, l = std::move(l), r = std::move(r)] {
+        ++*count;
+        Value a = l();
+        return Value::fromBool(VCompare(Op, a, r()));
+    };
+}
+
+void ClosureEngine::compile(const Program &program) {
+    slots.clear();
+    moduleNames = moduleBindings(program.body);
+    entry = block(program.body);
+    globals.assign(slots.size(), Value::None());
+    functions.assign(slots.size(), nullptr);
+    int maxFrame = 0;
+    for (auto &fn : compiled) maxFrame = std::max(maxFrame, fn.frameSize);
+    frames.reserve(maxFrame);
+    // keys point into the program's arena
+    slots.clear();
+    moduleNames.clear();
+}
+
+int ClosureEngine::slot(std::string_view id) {
+    return slots.emplace(id, int(slots.size())).first->second;
+}
+
+ClosureEngine::Var ClosureEngine::var(std::string_view id) {
+    if (locals) {
+        auto it = locals->find(id);
+        if (it != locals->end()) return {it->second, true};
+    }
+    return {slot(id), false};
+}
+
+void ClosureEngine::run() { entry(); }
+
+StmtFn ClosureEngine::block(const Block &body) {
+    std::vector<StmtFn> stmts;
+    for (auto s : body) stmts.push_back(stmt(s));
+    if (stmts.size() == 1) return std::move(stmts[0]);
+    return [stmts = std::move(stmts)] {
+        for (auto &s : stmts) {
+            Flow f = s();
+            if (f != Flow::Normal) return f;
+        }
+        return Flow::Normal;
+    };
+}
+
+StmtFn ClosureEngine::stmt(const Stmt *s) {
+    uint64_t *count = &dispatches;
+    switch (s->kind) {
+        case Stmt::ExprS: {
+            ExprFn e = expr(static_cast<const ExprStmt *>(s)->expr);
+            return [e = std::move(e)] { e(); return Flow::Normal; };
+        }
+        case Stmt::Assign: return assign(static_cast<const AssignStmt *>(s));
+        case Stmt::AugAssign: return augAssign(static_cast<const AugAssignStmt *>(s));
+        case Stmt::If: {
+            auto is = static_cast<const IfStmt *>(s);
+            std::vector<std::pair<ExprFn, StmtFn>> branches;
+            for (auto &br : is->branches) branches.emplace_back(expr(br.cond), block(br.body));
+            StmtFn orelse = block(is->orelse);
+            return [count, branches = std::move(branches), orelse = std::move(orelse)] {
+                ++*count;
+                for (auto &br : branches)
+                    if (br.first().truthy()) return br.second();
+                return orelse();
+            };
+        }
+        case Stmt::While: {
+            auto ws = static_cast<const WhileStmt *>(s);
+            ExprFn cond = expr(ws->cond);
+            StmtFn body = block(ws->body);
+            return [count, cond = std::move(cond), body = std::move(body)] {
+                ++*count;
+                while (cond().truthy()) {
+                    Flow f = body();
+                    if (f == Flow::Break) break;
+                    if (f == Flow::Return || f == Flow::TailCall) return f;
+                }
+                return Flow::Normal;
+            };
+        }
+        case Stmt::Break: return [] { return Flow::Break; };
+        case Stmt::Continue: return [] { return Flow::Continue; };
+        case Stmt::Return: {
+            auto rs = static_cast<const ReturnStmt *>(s);
+            if (!rs->value) return [this] { retval = Value(); return Flow::Return; };
+            if (tailCalls && locals && rs->value->kind == Expr::Call &&
+                builtinByName(static_cast<const CallExpr *>(rs->value)->callee) == Builtin::None)
+                return tailCall(static_cast<const CallExpr *>(rs->value));
+            return [this, value = expr(rs->value)] { retval = value(); return Flow::Return; };
+        }
+        case Stmt::FuncDef: return funcDef(static_cast<const FuncDefStmt *>(s));
+    }
+    return [] { return Flow::Normal; };
+}
+
+StmtFn ClosureEngine::assign(const AssignStmt *as) {
+    if (as->targets.size == 1 && as->targets[0].size > 1) {
+        // a, b = x, y: evaluate every value first, then bind left to right
+        auto &names = as->targets[0];
+        auto *tuple = as->value->kind == Expr::Tuple ? static_cast<const TupleExpr *>(as->value) : nullptr;
+        if (!tuple || tuple->elems.size != names.size)
+            throw std::runtime_error("cannot unpack value into " + std::to_string(names.size) + " names");
+        std::vector<Var> targets;
+        for (auto id : names) targets.push_back(var(id));
+        std::vector<ExprFn> values;
+        for (auto e : tuple->elems) values.push_back(expr(e));
+        return [this, targets = std::move(targets), values = std::move(values)] {
+            ++dispatches;
+            std::vector<Value> vals;
+            vals.reserve(values.size());
+            for (auto &v : values) vals.push_back(v());
+            for (size_t i = 0; i < targets.size(); ++i) ref(targets[i]) = std::move(vals[i]);
+            return Flow::Normal;
+        };
+    }
+    ExprFn value = expr(as->value);
+    if (as->targets.size == 1) {
+        Var target = var(as->targets[0][0]);
+        if (target.local)
+            return [this, at = target.index, value = std::move(value)] {
+                ++dispatches;
+                fp[at] = value();
+                return Flow::Normal;
+            };
+        return [this, at = target.index, value = std::move(value)] {
+            ++dispatches;
+            globals[at] = value();
+            return Flow::Normal;
+        };
+    }
+    std::vector<Var> targets;
+    for (auto &t : as->targets) targets.push_back(var(t[0]));
+    return [this, targets = std::move(targets), value = std::move(value)] {
+        ++dispatches;
+        Value v = value();
+        for (auto t : targets) ref(t) = v;
+        return Flow::Normal;
+    };
+}
+
+// The target is read before the value runs, as in Python; when the value may
+// call a user function that rebinds the target, the old value is copied first.
+StmtFn ClosureEngine::augAssign(const AugAssignStmt *as) {
+    Var target = var(as->target);
+    ExprFn value = expr(as->value);
+    BinaryFn fn = binaryFn(as->op);
+    if (callsFunction(as->value))
+        return [this, target, value = std::move(value), fn] {
+            ++dispatches;
+            Value lhs = ref(target);
+            Value res = fn(lhs, value());
+            ref(target) = std::move(res);
+            return Flow::Normal;
+        };
+    if (target.local)
+        return [this, at = target.index, value = std::move(value), fn] {
+            ++dispatches;
+            Value res = fn(fp[at], value());
+            fp[at] = std::move(res);
+            return Flow::Normal;
+        };
+    return [this, at = target.index, value = std::move(value), fn] {
+        ++dispatches;
+        Value res = fn(globals[at], value());
+        globals[at] = std::move(res);
+        return Flow::Normal;
+    };
+}
+
+// The body is compiled once, here; running the def only evaluates the
+// defaults and binds the name.
+StmtFn ClosureEngine::funcDef(const FuncDefStmt *fd) {
+    std::vector<std::string_view> names = functionLocals(fd, moduleNames);
+    std::unordered_map<std::string_view, int> frame;
+    for (auto id : names) frame.emplace(id, int(frame.size()));
+    Function &fn = compiled.emplace_back();
+    fn.name = std::string(fd->name);
+    fn.frameSize = int(frame.size());
+    std::vector<ExprFn> defaults;
+    for (auto &p : fd->params) {
+        fn.params.emplace_back(p.name);
+        if (p.defaultValue) defaults.push_back(expr(p.defaultValue));
+    }
+    auto outer = locals;
+    locals = &frame;
+    fn.body = block(fd->body);
+    locals = outer;
+    int at = slot(fd->name);
+    return [this, &fn, at, defaults = std::move(defaults)] {
+        ++dispatches;
+        BoundFunction &b = bound.emplace_back(BoundFunction{&fn, {}});
+        for (auto &d : defaults) b.defaults.push_back(d());
+        functions[at] = &b;
+        return Flow::Normal;
+    };
+}
+
+ExprFn ClosureEngine::expr(const Expr *e) {
+    uint64_t *count = &dispatches;
+    switch (e->kind) {
+        case Expr::Const: {
+            Value v = static_cast<const ConstExpr *>(e)->value;
+            return [count, v] { ++*count; return v; };
+        }
+        case Expr::Name: return load(static_cast<const NameExpr *>(e)->id);
+        case Expr::Neg: {
+            ExprFn o = expr(static_cast<const UnaryExpr *>(e)->operand);
+            return [count, o = std::move(o)] { ++*count; return VNeg(o()); };
+        }
+        case Expr::Not: {
+            ExprFn o = expr(static_cast<const UnaryExpr *>(e)->operand);
+            return [count, o = std::move(o)] { ++*count; return Value::fromBool(!o().truthy()); };
+        }
+        case Expr::Binary: return binary(static_cast<const BinaryExpr *>(e));
+        case Expr::Compare: return compare(static_cast<const CompareExpr *>(e));
+        case Expr::And: case Expr::Or: return logic(static_cast<const LogicExpr *>(e));
+        case Expr::Call: return call(static_cast<const CallExpr *>(e));
+        case Expr::FString: return fstring(static_cast<const FStringExpr *>(e));
+        case Expr::Tuple:
+            // tuple values are not first-class yet; like the visitor, keep the first element
+            return expr(static_cast<const TupleExpr *>(e)->elems[0]);
+    }
+    return [] { return Value::None(); };
+}
+
+ExprFn ClosureEngine::load(std::string_view id) {
+    Var v = var(id);
+    if (v.local)
+        return [this, at = v.index] {
+            ++dispatches;
+            return fp[at];
+        };
+    return [this, at = v.index] {
+        ++dispatches;
+        return globals[at];
+    };
+}
+
+ExprFn ClosureEngine::binary(const BinaryExpr *e) {
+    ExprFn l = expr(e->lhs), r = expr(e->rhs);
+    uint64_t *count = &dispatches;
+    switch (e->op) {
+        case BinOp::Add: return bindBinary<VAdd>(count, std::move(l), std::move(r));
+        case BinOp::Sub: return bindBinary<VSub>(count, std::move(l), std::move(r));
+        case BinOp::Mul: return bindBinary<VMul>(count, std::move(l), std::move(r));
+        case BinOp::Div: return bindBinary<VDivFloat>(count, std::move(l), std::move(r));
+        case BinOp::IDiv: return bindBinary<VDivInt>(count, std::move(l), std::move(r));
+        case BinOp::Mod: return bindBinary<VMod>(count, std::move(l), std::move(r));
+    }
+    return l;
+}
+
+ExprFn ClosureEngine::compare(const CompareExpr *e) {
+    uint64_t *count = &dispatches;
+    if (e->ops.size == 1) {
+        ExprFn l = expr(e->operands[0]), r = expr(e->operands[1]);
+        switch (e->ops[0]) {
+            case CmpOp::Lt: return bindCompare<CmpOp::Lt>(count, std::move(l), std::move(r));
+            case CmpOp::Gt: return bindCompare<CmpOp::Gt>(count, std::move(l), std::move(r));
+            case CmpOp::Eq: return bindCompare<CmpOp::Eq>(count, std::move(l), std::move(r));
+            case CmpOp::Ge: return bindCompare<CmpOp::Ge>(count, std::move(l), std::move(r));
+            case CmpOp::Le: return bindCompare<CmpOp::Le>(count, std::move(l), std::move(r));
+            case CmpOp::Ne: return bindCompare<CmpOp::Ne>(count, std::move(l), std::move(r));
+        }
+    }
+    // chains evaluate each operand at most once and stop at the first false link
+    std::vector<ExprFn> operands;
+    for (auto o : e->operands) operands.push_back(expr(o));
+    std::vector<CmpOp> ops(e->ops.begin(), e->ops.end());
+    return [count, operands = std::move(operands), ops = std::move(ops)] {
+        ++*count;
+        Value lhs = operands[0]();
+        for (size_t i = 0; i < ops.size(); ++i) {
+            Value rhs = operands[i + 1]();
+            if (!VCompare(ops[i], lhs, rhs)) return Value::fromBool(false);
+            lhs = std::move(rhs);
+        }
+        return Value::fromBool(true);
+    };
+}
+
+ExprFn ClosureEngine::logic(const LogicExpr *e) {
+    std::vector<ExprFn> operands;
+    for (auto o : e->operands) operands.push_back(expr(o));
+    bool stopWhen = e->kind == Expr::Or; // Or stops at the first truthy operand
+    return [count = &dispatches, operands = std::move(operands), stopWhen] {
+        ++*count;
+        Value cur = operands[0]();
+        for (size_t i = 1; i < operands.size() && cur.truthy() != stopWhen; ++i) cur = operands[i]();
+        return cur;
+    };
+}
+
+ExprFn ClosureEngine::call(const CallExpr *e) {
+    std::vector<ExprFn> args;
+    for (auto &arg : e->args) args.push_back(expr(arg.value));
+    Builtin fn = builtinByName(e->callee);
+    if (fn != Builtin::None)
+        return [count = &dispatches, fn, args = std::move(args)] {
+            ++*count;
+            std::vector<Value> vals;
+            vals.reserve(args.size());
+            for (auto &a : args) vals.push_back(a());
+            return VCallBuiltin(fn, vals.data(), vals.size());
+        };
+    CallSite *site = &sites.emplace_back();
+    for (auto &arg : e->args) site->keywords.emplace_back(arg.keyword);
+    return [this, site, at = slot(e->callee), name = std::string(e->callee), args = std::move(args)] {
+        ++dispatches;
+        // arguments are evaluated in the caller's scope before the callee is
+        // looked up, as in the VMs; nested calls stack theirs above them
+        size_t base = argStack.size();
+        for (auto &a : args) argStack.push_back(a());
+        const BoundFunction *fn = callee(site, at, name);
+        const Function *f = fn->fn;
+        Value *frame = frames.push(f->frameSize);
+        for (size_t i = 0; i < args.size(); ++i) frame[site->binding.slotOfArg[i]] = std::move(argStack[base + i]);
+        argStack.resize(base);
+        completeFrame(frame, *fn, site->binding);
+        Value *caller = fp;
+        fp = frame;
+        Flow flow = f->body();
+        while (flow == Flow::TailCall) {
+            // the tail callee takes this frame's place, at the same depth
+            frames.pop(f->frameSize);
+            f = tailFn->fn;
+            fp = frame = frames.push(f->frameSize); // the same base, as this was the top frame
+            for (size_t i = 0; i < tailArgs.size(); ++i) frame[tailSite->binding.slotOfArg[i]] = std::move(tailArgs[i]);
+            completeFrame(frame, *tailFn, tailSite->binding);
+            flow = f->body();
+        }
+        fp = caller;
+        frames.pop(f->frameSize);
+        return flow == Flow::Return ? std::move(retval) : Value();
+    };
+}
+
+// `return f(...)` with f a user function: the arguments are evaluated here,
+// in the returning frame, and the call that is returning runs f in its place.
+StmtFn ClosureEngine::tailCall(const CallExpr *e) {
+    std::vector<ExprFn> args;
+    for (auto &arg : e->args) args.push_back(expr(arg.value));
+    CallSite *site = &sites.emplace_back();
+    for (auto &arg : e->args) site->keywords.emplace_back(arg.keyword);
+    return [this, site, at = slot(e->callee), name = std::string(e->callee), args = std::move(args)] {
+        ++dispatches;
+        // a tail call among the arguments has finished before they are handed over
+        std::vector<Value> vals;
+        vals.reserve(args.size());
+        for (auto &a : args) vals.push_back(a());
+        const BoundFunction *fn = callee(site, at, name);
+        tailArgs = std::move(vals);
+        tailFn = fn;
+        tailSite = site;
+        return Flow::TailCall;
+    };
+}
+
+// The function bound to global slot `at`, with the site's binding made current for it.
+const ClosureEngine::BoundFunction *ClosureEngine::callee(CallSite *site, int at, const std::string &name) {
+    const BoundFunction *fn = functions[at];
+    if (!fn) throw std::runtime_error("'" + name + "' is not a function");
+    if (fn != site->fn) {
+        site->binding = bindArguments(name, fn->fn->params, fn->defaults.size(), site->keywords);
+        site->fn = fn;
+    }
+    return fn;
+}
+
+void ClosureEngine::completeFrame(Value *frame, const BoundFunction &callee, const ArgBinding &binding) {
+    static const Value none;
+    const Function &f = *callee.fn;
+    size_t numParams = f.params.size(), firstDefault = numParams - callee.defaults.size();
+    for (int p : binding.fromDefault) frame[p] = callee.defaults[p - firstDefault];
+    for (size_t i = numParams; i < size_t(f.frameSize); ++i) frame[i] = none;
+}
+
+ExprFn ClosureEngine::fstring(const FStringExpr *e) {
+    // literal pieces are kept as strings; expression slots as callables
+    std::vector<std::pair<std::string, ExprFn>> parts;
+    for (auto &part : e->parts) {
+        if (part.expr) parts.emplace_back(std::string(), expr(part.expr));
+        else parts.emplace_back(std::string(part.literal), nullptr);
+    }
+    return [count = &dispatches, parts = std::move(parts)] {
+        ++*count;
+        std::string out;
+        for (auto &p : parts) {
+            if (p.second) p.second().appendTo(out);
+            else out += p.first;
+        }
+        return Value::fromStr(out);
+    };
+}
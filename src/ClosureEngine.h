@@ -0,0 +1,91 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_CLOSUREENGINE_H
+#define PYTHON_INTERPRETER_CLOSUREENGINE_H
+
+#include <bits/stdc++.h>
+#include "Ast.h"
+#include "Scope.h"
+#include "Frames.h"
+
+// Compiles every AST node once into a pre-bound callable: operator choice,
+// child callables and literal values are fixed at compile time, so running a
+// node is a single indirect call with no re-inspection of the tree.
+class ClosureEngine {
+public:
+    // completion of a statement; loops consume Break/Continue. TailCall is a
+    // `return f(...)` whose callee and arguments wait in tailFn/tailSite/tailArgs.
+    enum class Flow : uint8_t { Normal, Break, Continue, Return, TailCall };
+    using ExprFn = std::function<Value()>;
+    using StmtFn = std::function<Flow()>;
+
+    // global slots, numbered at compile time in order of first appearance
+    std::vector<Value> globals;
+    uint64_t dispatches = 0;
+    // `return f(...)` inside a def reuses the returning call's frame
+    bool tailCalls = true;
+
+    void compile(const ast::Program &program);
+    void run();
+
+private:
+    // a compiled def
+    struct Function {
+        std::string name;
+        std::vector<std::string> params;
+        int frameSize = 0;
+        StmtFn body;
+    };
+    // a def that has run, with the defaults it evaluated
+    struct BoundFunction {
+        const Function *fn;
+        std::vector<Value> defaults;
+    };
+    // binding cached by a call site for the function it last called
+    struct CallSite {
+        const BoundFunction *fn = nullptr;
+        ArgBinding binding;
+        std::vector<std::string> keywords;
+    };
+    // a variable resolved at compile time
+    struct Var {
+        int index;
+        bool local;
+    };
+
+    StmtFn entry;
+    std::unordered_map<std::string_view, int> slots;
+    ast::NameSet moduleNames;
+    const std::unordered_map<std::string_view, int> *locals = nullptr; // of the def being compiled
+    std::deque<Function> compiled;
+    std::deque<BoundFunction> bound;
+    std::deque<CallSite> sites;
+    std::vector<const BoundFunction *> functions; // by global slot
+    FrameStack frames;
+    Value *fp = nullptr; // locals of the running call
+    Value retval;        // set by return, taken by the call
+    std::vector<Value> argStack; // arguments of the calls being set up, innermost last
+    const BoundFunction *tailFn = nullptr; // set by a tail call, run by the call returning
+    const CallSite *tailSite = nullptr;
+    std::vector<Value> tailArgs;
+
+    StmtFn block(const ast::Block &body);
+    StmtFn stmt(const ast::Stmt *s);
+    StmtFn assign(const ast::AssignStmt *as);
+    StmtFn augAssign(const ast::AugAssignStmt *as);
+    StmtFn funcDef(const ast::FuncDefStmt *fd);
+    ExprFn expr(const ast::Expr *e);
+    ExprFn binary(const ast::BinaryExpr *e);
+    ExprFn compare(const ast::CompareExpr *e);
+    ExprFn logic(const ast::LogicExpr *e);
+    ExprFn call(const ast::CallExpr *e);
+    StmtFn tailCall(const ast::CallExpr *e);
+    const BoundFunction *callee(CallSite *site, int at, const std::string &name);
+    static void completeFrame(Value *frame, const BoundFunction &callee, const ArgBinding &binding);
+    ExprFn fstring(const ast::FStringExpr *e);
+    ExprFn load(std::string_view id);
+    int slot(std::string_view id);
+    Var var(std::string_view id);
+    Value &ref(Var v) { return v.local ? fp[v.index] : globals[v.index]; }
+};
+
+#endif//PYTHON_INTERPRETER_CLOSUREENGINE_H
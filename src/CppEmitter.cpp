@@ -0,0 +1,543 @@
+#include "CppEmitter.h"
+#include "Frames.h"
+
+using namespace ast;
+
+namespace {
+
+// a C++ identifier for a Python name; bytes outside [A-Za-z0-9_] are hex-escaped
+std::string ident(std::string_view id) {
+    std::string s;
+    for (unsigned char c : id) {
+        if (std::isalnum(c) || c == '_') {
+            s += char(c);
+        } else {
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "_x%02x", c);
+            s += buf;
+        }
+    }
+    return s;
+}
+
+// a C++ string literal; octal escapes cannot run into the following text
+std::string quote(std::string_view text) {
+    std::string s = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            s += '\\';
+            s += char(c);
+        } else if (c < 0x20 || c >= 0x7f) {
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "\\%03o", c);
+            s += buf;
+        } else {
+            s += char(c);
+        }
+    }
+    return s + "\"";
+}
+
+const char *binOp(BinOp op) {
+    static const char *const names[] = {"Add", "Sub", "Mul", "Div", "IDiv", "Mod"};
+    return names[int(op)];
+}
+
+const char *cmpOp(CmpOp op) {
+    static const char *const names[] = {"Lt", "Gt", "Eq", "Ge", "Le", "Ne"};
+    return names[int(op)];
+}
+
+const char *builtin(Builtin fn) {
+    static const char *const names[] = {"Print", "Int", "Float", "Str", "Bool"};
+    return names[int(fn)];
+}
+
+bool isTemp(const std::string &v) { return v.rfind("t[", 0) == 0; }
+
+std::string compare(CmpOp op, const std::string &l, const std::string &r) {
+    return std::string("compare<CmpOp::") + cmpOp(op) + ">(" + l + ", " + r + ")";
+}
+
+void collectDefs(const Block &body, std::vector<const FuncDefStmt *> &out) {
+    for (auto s : body) {
+        switch (s->kind) {
+            case Stmt::If: {
+                auto is = static_cast<const IfStmt *>(s);
+                for (auto &br : is->branches) collectDefs(br.body, out);
+                collectDefs(is->orelse, out);
+                break;
+            }
+            case Stmt::While: collectDefs(static_cast<const WhileStmt *>(s)->body, out); break;
+            case Stmt::FuncDef: {
+                auto fd = static_cast<const FuncDefStmt *>(s);
+                out.push_back(fd);
+                collectDefs(fd->body, out);
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+} // namespace
+
+void CppEmitter::emit(const Program &program, std::ostream &os) {
+    moduleNames = moduleBindings(program.body);
+    collectDefs(program.body, defs);
+    for (size_t i = 0; i < defs.size(); ++i) named[defs[i]->name].push_back(int(i));
+
+    // the module code, then every def; globals and constants they use are
+    // declared ahead of all of them
+    std::ostringstream bodies;
+    inFunction = false;
+    temp = peak = bools = loops = 0;
+    block(program.body);
+    std::string moduleCode = out.str();
+    int modulePeak = peak;
+    for (size_t i = 0; i < defs.size(); ++i) bodies << '\n' << function(defs[i], int(i));
+
+    os << "// Translated from Python by `code --emit-cpp`. Build it against the\n"
+       << "// interpreter's runtime:\n"
+       << "//   g++ -std=c++17 -O2 -I<repo>/src prog.cpp <repo>/src/Value.cpp <repo>/src/Output.cpp \\\n"
+       << "//       <repo>/src/Frames.cpp\n"
+       << "#include \"CppRuntime.h\"\n\nnamespace {\n\n";
+    for (auto id : globals) os << "Value g_" << ident(id) << ";\n";
+    std::set<std::string_view> defNames;
+    for (auto fd : defs) defNames.insert(fd->name);
+    for (auto id : defNames) os << "int fn_" << ident(id) << " = -1; // index of the def bound to " << id << "\n";
+    for (size_t i = 0; i < consts.size(); ++i) os << "const Value k" << i << " = " << consts[i] << ";\n";
+    for (size_t i = 0; i < defs.size(); ++i) {
+        int defaults = 0;
+        for (auto &p : defs[i]->params) defaults += p.defaultValue != nullptr;
+        for (int j = 0; j < defaults; ++j) os << "Value f" << i << "_d" << j << ";\n";
+    }
+    os << '\n';
+    for (size_t i = 0; i < defs.size(); ++i) {
+        os << "Value f" << i << "(";
+        for (uint32_t j = 0; j < defs[i]->params.size; ++j) os << (j ? ", " : "") << "Value";
+        os << ");\n";
+    }
+    os << bodies.str() << "\nvoid module() {\n";
+    if (modulePeak) os << "    Value t[" << modulePeak << "];\n";
+    os << moduleCode << "}\n\n} // namespace\n\nint main() { return aot::run(module); }\n";
+}
+
+std::string CppEmitter::function(const FuncDefStmt *fd, int index) {
+    out.str("");
+    locals.clear();
+    std::vector<std::string_view> slots = functionLocals(fd, moduleNames);
+    for (auto id : slots) locals.insert(id);
+    inFunction = true;
+    current = index;
+    reentered = false;
+    temp = peak = bools = loops = 0;
+    block(fd->body);
+    inFunction = false;
+    current = -1;
+
+    std::ostringstream os;
+    os << "// def " << fd->name << "\nValue f" << index << "(";
+    for (uint32_t i = 0; i < fd->params.size; ++i) os << (i ? ", " : "") << "Value l_" << ident(fd->params[i].name);
+    os << ") {\n    aot::CallDepth guard;\n";
+    for (size_t i = fd->params.size; i < slots.size(); ++i) os << "    Value l_" << ident(slots[i]) << ";\n";
+    if (peak) os << "    Value t[" << peak << "];\n";
+    if (reentered) os << "entry:\n";
+    os << out.str() << "    return Value();\n}\n";
+    out.str("");
+    return os.str();
+}
+
+void CppEmitter::line(const std::string &s) {
+    out << std::string(indent * 4, ' ') << s << '\n';
+}
+
+std::string CppEmitter::newTemp() {
+    peak = std::max(peak, temp + 1);
+    return "t[" + std::to_string(temp++) + "]";
+}
+
+std::string CppEmitter::var(std::string_view id) {
+    if (inFunction && locals.count(id)) return "l_" + ident(id);
+    if (declared.insert(id).second) globals.push_back(id);
+    return "g_" + ident(id);
+}
+
+std::string CppEmitter::constant(const Value &v) {
+    std::string init;
+    switch (v.type) {
+        case Value::T_INT:
+            if (v.i.d.size() == 1) init = "Value::fromInt(BigInt::fromLL(" + v.i.toString() + "))";
+            else init = "Value::fromInt(BigInt::fromString(\"" + v.i.toString() + "\"))";
+            break;
+        case Value::T_FLOAT: {
+            char buf[64];
+            if (std::isnan(v.f)) std::snprintf(buf, sizeof buf, "NAN");
+            else if (std::isinf(v.f)) std::snprintf(buf, sizeof buf, v.f < 0 ? "-HUGE_VAL" : "HUGE_VAL");
+            else std::snprintf(buf, sizeof buf, "%a", v.f); // exact
+            init = std::string("Value::fromFloat(") + buf + ")";
+            break;
+        }
+        case Value::T_BOOL: init = v.b ? "Value::fromBool(true)" : "Value::fromBool(false)"; break;
+        case Value::T_STR: init = "Value::fromStr(" + quote(v.s) + ")"; break;
+        case Value::T_NONE: init = "Value()"; break;
+    }
+    auto [it, added] = constIndex.emplace(init, int(consts.size()));
+    if (added) consts.push_back(init);
+    return "k" + std::to_string(it->second);
+}
+
+std::string CppEmitter::pin(const std::string &v, const Expr *later) {
+    if (v.rfind("g_", 0) != 0 || !callsFunction(later)) return v;
+    std::string t = newTemp();
+    line(t + " = " + v + ";");
+    return t;
+}
+
+void CppEmitter::block(const Block &body) {
+    for (auto s : body) {
+        stmt(s);
+        temp = 0;
+    }
+}
+
+void CppEmitter::stmt(const Stmt *s) {
+    switch (s->kind) {
+        case Stmt::ExprS: {
+            auto e = static_cast<const ExprStmt *>(s)->expr;
+            if (e->kind == Expr::Call) call(static_cast<const CallExpr *>(e), "", true);
+            else expr(e);
+            break;
+        }
+        case Stmt::Assign: {
+            auto as = static_cast<const AssignStmt *>(s);
+            if (as->targets.size == 1 && as->targets[0].size > 1) {
+                // a, b = x, y: every value first, then the bindings
+                auto &names = as->targets[0];
+                auto *tuple = as->value->kind == Expr::Tuple ? static_cast<const TupleExpr *>(as->value) : nullptr;
+                if (!tuple || tuple->elems.size != names.size)
+                    throw std::runtime_error("cannot unpack value into " + std::to_string(names.size) + " names");
+                std::vector<std::string> values;
+                for (auto e : tuple->elems) values.push_back(expr(e, newTemp()));
+                for (uint32_t i = 0; i < names.size; ++i) line(var(names[i]) + " = std::move(" + values[i] + ");");
+                break;
+            }
+            std::string first = var(as->targets[0][0]);
+            expr(as->value, first);
+            for (uint32_t i = 1; i < as->targets.size; ++i) line(var(as->targets[i][0]) + " = " + first + ";");
+            break;
+        }
+        case Stmt::AugAssign: {
+            auto as = static_cast<const AugAssignStmt *>(s);
+            std::string v = var(as->target);
+            std::string l = pin(v, as->value);
+            std::string r = expr(as->value);
+            line(std::string("arith<BinOp::") + binOp(as->op) + ">(" + v + ", " + l + ", " + r + ");");
+            break;
+        }
+        case Stmt::If:
+            branches(static_cast<const IfStmt *>(s), 0);
+            break;
+        case Stmt::While: {
+            auto ws = static_cast<const WhileStmt *>(s);
+            line("for (;;) {");
+            ++indent;
+            ++loops;
+            line("if (!(" + cond(ws->cond) + ")) break;");
+            temp = 0;
+            block(ws->body);
+            --loops;
+            --indent;
+            line("}");
+            break;
+        }
+        case Stmt::Break:
+            if (loops) line("break;");
+            break;
+        case Stmt::Continue:
+            if (loops) line("continue;");
+            break;
+        case Stmt::Return: {
+            auto rs = static_cast<const ReturnStmt *>(s);
+            if (!inFunction) {
+                line("return;"); // a module-level return ends the program
+                break;
+            }
+            if (!rs->value) {
+                line("return Value();");
+                break;
+            }
+            if (tailCalls && rs->value->kind == Expr::Call &&
+                builtinByName(static_cast<const CallExpr *>(rs->value)->callee) == Builtin::None) {
+                call(static_cast<const CallExpr *>(rs->value), "", false, true);
+                break;
+            }
+            std::string v = expr(rs->value);
+            line("return " + (isTemp(v) ? "std::move(" + v + ")" : v) + ";");
+            break;
+        }
+        case Stmt::FuncDef: {
+            auto fd = static_cast<const FuncDefStmt *>(s);
+            int index = int(std::find(defs.begin(), defs.end(), fd) - defs.begin());
+            int defaults = 0;
+            for (auto &p : fd->params)
+                if (p.defaultValue) {
+                    expr(p.defaultValue, "f" + std::to_string(index) + "_d" + std::to_string(defaults++));
+                    temp = 0;
+                }
+            line("fn_" + ident(fd->name) + " = " + std::to_string(index) + ";");
+            break;
+        }
+    }
+}
+
+void CppEmitter::branches(const IfStmt *is, uint32_t i) {
+    line("if (" + cond(is->branches[i].cond) + ") {");
+    ++indent;
+    temp = 0;
+    block(is->branches[i].body);
+    --indent;
+    if (i + 1 < is->branches.size) {
+        line("} else {");
+        ++indent;
+        branches(is, i + 1);
+        --indent;
+    } else if (!is->orelse.empty()) {
+        line("} else {");
+        ++indent;
+        block(is->orelse);
+        --indent;
+    }
+    line("}");
+}
+
+std::string CppEmitter::cond(const Expr *e) {
+    switch (e->kind) {
+        case Expr::Not: return "!(" + cond(static_cast<const UnaryExpr *>(e)->operand) + ")";
+        case Expr::Compare: {
+            // one link at a time, so later operands stay unevaluated
+            auto ce = static_cast<const CompareExpr *>(e);
+            std::string l = expr(ce->operands[0]);
+            if (ce->ops.size == 1) {
+                l = pin(l, ce->operands[1]);
+                return compare(ce->ops[0], l, expr(ce->operands[1]));
+            }
+            std::string b = "b" + std::to_string(bools++);
+            int opened = 0;
+            for (uint32_t i = 0; i < ce->ops.size; ++i) {
+                l = pin(l, ce->operands[i + 1]);
+                std::string r = expr(ce->operands[i + 1]);
+                line((i ? b : "bool " + b) + " = " + compare(ce->ops[i], l, r) + ";");
+                if (i + 1 < ce->ops.size) {
+                    line("if (" + b + ") {");
+                    ++indent;
+                    ++opened;
+                }
+                l = r;
+            }
+            for (; opened; --opened) {
+                --indent;
+                line("}");
+            }
+            return b;
+        }
+        case Expr::And:
+        case Expr::Or: {
+            auto le = static_cast<const LogicExpr *>(e);
+            std::string b = "b" + std::to_string(bools++);
+            int mark = temp, opened = 0;
+            for (uint32_t i = 0; i < le->operands.size; ++i) {
+                std::string c = cond(le->operands[i]);
+                line((i ? b : "bool " + b) + " = " + c + ";");
+                temp = mark;
+                if (i + 1 < le->operands.size) {
+                    line(e->kind == Expr::And ? "if (" + b + ") {" : "if (!" + b + ") {");
+                    ++indent;
+                    ++opened;
+                }
+            }
+            for (; opened; --opened) {
+                --indent;
+                line("}");
+            }
+            return b;
+        }
+        default: return expr(e) + ".truthy()";
+    }
+}
+
+std::string CppEmitter::expr(const Expr *e, const std::string &dst) {
+    auto place = [&] { return dst.empty() ? newTemp() : dst; };
+    switch (e->kind) {
+        case Expr::Const: {
+            std::string k = constant(static_cast<const ConstExpr *>(e)->value);
+            if (dst.empty()) return k;
+            line(dst + " = " + k + ";");
+            return dst;
+        }
+        case Expr::Name: {
+            std::string v = var(static_cast<const NameExpr *>(e)->id);
+            if (dst.empty() || dst == v) return v;
+            line(dst + " = " + v + ";");
+            return dst;
+        }
+        case Expr::Neg: {
+            int mark = temp;
+            std::string o = expr(static_cast<const UnaryExpr *>(e)->operand);
+            temp = mark;
+            std::string d = place();
+            line(d + " = VNeg(" + o + ");");
+            return d;
+        }
+        case Expr::Not:
+        case Expr::Compare: {
+            int mark = temp;
+            std::string c = cond(e);
+            temp = mark;
+            std::string d = place();
+            line("setBool(" + d + ", " + c + ");");
+            return d;
+        }
+        case Expr::Binary: {
+            auto be = static_cast<const BinaryExpr *>(e);
+            int mark = temp;
+            std::string l = pin(expr(be->lhs), be->rhs);
+            std::string r = expr(be->rhs);
+            temp = mark;
+            std::string d = place();
+            line(std::string("arith<BinOp::") + binOp(be->op) + ">(" + d + ", " + l + ", " + r + ");");
+            return d;
+        }
+        case Expr::And:
+        case Expr::Or: {
+            // built in a temporary so that a variable used as dst is read first
+            auto le = static_cast<const LogicExpr *>(e);
+            std::string d = isTemp(dst) ? dst : newTemp();
+            int mark = temp, opened = 0;
+            for (uint32_t i = 0; i < le->operands.size; ++i) {
+                expr(le->operands[i], d);
+                temp = mark;
+                if (i + 1 < le->operands.size) {
+                    line(e->kind == Expr::And ? "if (" + d + ".truthy()) {" : "if (!" + d + ".truthy()) {");
+                    ++indent;
+                    ++opened;
+                }
+            }
+            for (; opened; --opened) {
+                --indent;
+                line("}");
+            }
+            if (dst.empty() || dst == d) return d;
+            line(dst + " = std::move(" + d + ");");
+            return dst;
+        }
+        case Expr::Call:
+            return call(static_cast<const CallExpr *>(e), dst, false);
+        case Expr::FString: {
+            auto fs = static_cast<const FStringExpr *>(e);
+            int mark = temp;
+            std::vector<std::string> values;
+            for (uint32_t i = 0; i < fs->parts.size; ++i) {
+                if (!fs->parts[i].expr) continue;
+                std::string v = expr(fs->parts[i].expr);
+                for (uint32_t j = i + 1; j < fs->parts.size; ++j)
+                    if (fs->parts[j].expr) v = pin(v, fs->parts[j].expr);
+                values.push_back(v);
+            }
+            line("{");
+            ++indent;
+            line("std::string s;");
+            size_t next = 0;
+            for (auto &part : fs->parts) {
+                if (part.expr) line(values[next++] + ".appendTo(s);");
+                else line("s += " + quote(part.literal) + ";");
+            }
+            temp = mark;
+            std::string d = place();
+            line(d + ".type = Value::T_STR;");
+            line(d + ".s = std::move(s);");
+            --indent;
+            line("}");
+            return d;
+        }
+        case Expr::Tuple:
+            // tuple values are not first-class yet; like the interpreters, keep the first element
+            return expr(static_cast<const TupleExpr *>(e)->elems[0], dst);
+    }
+    return dst;
+}
+
+std::string CppEmitter::call(const CallExpr *e, const std::string &dst, bool discard, bool tail) {
+    int base = temp;
+    for (auto &arg : e->args) expr(arg.value, newTemp());
+    int argc = int(e->args.size);
+    temp = base;
+    std::string d = discard || tail ? "" : dst.empty() ? newTemp() : dst;
+    std::string assign = d.empty() ? "" : d + " = ";
+    Builtin fn = builtinByName(e->callee);
+    if (fn != Builtin::None) {
+        std::string args = argc ? "t + " + std::to_string(base) : "nullptr";
+        line(assign + "VCallBuiltin(Builtin::" + builtin(fn) + ", " + args + ", " + std::to_string(argc) + ");");
+        return d;
+    }
+    std::string name = quote(e->callee);
+    auto it = named.find(e->callee);
+    if (it == named.end()) {
+        line("aot::notAFunction(" + name + ");");
+        return d;
+    }
+    std::vector<std::string> keywords;
+    for (auto &arg : e->args) keywords.emplace_back(arg.keyword);
+    // the code calling def i, or raising the error binding the arguments to it
+    auto invoke = [&](int i) -> std::vector<std::string> {
+        const FuncDefStmt *fd = defs[i];
+        std::vector<std::string> params;
+        size_t defaults = 0;
+        for (auto &p : fd->params) {
+            params.emplace_back(p.name);
+            defaults += p.defaultValue != nullptr;
+        }
+        ArgBinding binding;
+        try {
+            binding = bindArguments(std::string(fd->name), params, defaults, keywords);
+        } catch (const std::runtime_error &error) {
+            return {"throw std::runtime_error(" + quote(error.what()) + ");"};
+        }
+        std::vector<std::string> args(params.size());
+        for (int a = 0; a < argc; ++a) args[binding.slotOfArg[a]] = "std::move(t[" + std::to_string(base + a) + "])";
+        for (int p : binding.fromDefault)
+            args[p] = "f" + std::to_string(i) + "_d" + std::to_string(p - (params.size() - defaults));
+        if (tail && i == current) {
+            // the arguments become the parameters and the other locals start over
+            std::vector<std::string> lines;
+            for (size_t p = 0; p < args.size(); ++p) lines.push_back("l_" + ident(params[p]) + " = " + args[p] + ";");
+            std::vector<std::string_view> slots = functionLocals(fd, moduleNames);
+            for (size_t p = params.size(); p < slots.size(); ++p) lines.push_back("l_" + ident(slots[p]) + " = Value();");
+            lines.push_back("goto entry;");
+            reentered = true;
+            return lines;
+        }
+        std::string text = "f" + std::to_string(i) + "(";
+        for (size_t p = 0; p < args.size(); ++p) text += (p ? ", " : "") + args[p];
+        text += ");";
+        if (tail) return {"guard.leave();", "return " + text};
+        return {assign + text};
+    };
+    std::string bound = "fn_" + ident(e->callee);
+    if (it->second.size() == 1) {
+        line("if (" + bound + " != " + std::to_string(it->second[0]) + ") aot::notAFunction(" + name + ");");
+        for (auto &text : invoke(it->second[0])) line(text);
+        return d;
+    }
+    line("switch (" + bound + ") {");
+    for (int i : it->second) {
+        line("case " + std::to_string(i) + ":");
+        ++indent;
+        for (auto &text : invoke(i)) line(text);
+        if (!tail) line("break;");
+        --indent;
+    }
+    line("default: aot::notAFunction(" + name + ");");
+    line("}");
+    return d;
+}
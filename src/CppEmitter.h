@@ -0,0 +1,62 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_CPPEMITTER_H
+#define PYTHON_INTERPRETER_CPPEMITTER_H
+
+#include <bits/stdc++.h>
+#include "Ast.h"
+#include "Scope.h"
+
+// Translates an ast::Program into one standalone C++ translation unit
+// (--emit-cpp) that includes CppRuntime.h and links the interpreter's
+// Value.cpp, Output.cpp and Frames.cpp. Every variable becomes a Value
+// (module ones at namespace scope, locals in their def's C++ function) and
+// expressions are lowered to statements over a per-function array of
+// temporaries, using the in-place small-int and float paths of SmallInt.h.
+// Each def becomes a C++ function over its parameters; calls are bound at
+// translation time to the defs their callee name can hold, keywords and
+// defaults included, and pick the one bound at run time.
+class CppEmitter {
+public:
+    // `return f(...)` does not deepen the call depth and, calling the def
+    // itself, loops back to its entry (--no-tail-calls clears it)
+    bool tailCalls = true;
+
+    void emit(const ast::Program &program, std::ostream &os);
+
+private:
+    std::vector<const ast::FuncDefStmt *> defs;                   // by index
+    std::unordered_map<std::string_view, std::vector<int>> named; // def indices per name
+    ast::NameSet moduleNames;
+    std::vector<std::string_view> globals; // in order of first use
+    ast::NameSet declared;
+    std::vector<std::string> consts;       // initializers of k0, k1, ...
+    std::unordered_map<std::string, int> constIndex;
+
+    // the function being emitted
+    std::ostringstream out;
+    ast::NameSet locals;
+    bool inFunction = false;
+    int current = -1; // index of the def being emitted
+    bool reentered = false; // it tail-calls itself, so its body has an entry label
+    int indent = 1, temp = 0, peak = 0, bools = 0, loops = 0;
+
+    void line(const std::string &s);
+    std::string newTemp();
+    std::string var(std::string_view id);
+    std::string constant(const Value &v);
+    // Copies a module variable that evaluating later could rebind.
+    std::string pin(const std::string &v, const ast::Expr *later);
+    std::string function(const ast::FuncDefStmt *fd, int index);
+
+    void block(const ast::Block &body);
+    void stmt(const ast::Stmt *s);
+    void branches(const ast::IfStmt *is, uint32_t i);
+    // Emits the statements computing e; returns the Value holding it, dst if given.
+    std::string expr(const ast::Expr *e, const std::string &dst = "");
+    // Emits the statements deciding e; returns a C++ bool expression.
+    std::string cond(const ast::Expr *e);
+    // Emits a call; a tail call returns its result from the current def.
+    std::string call(const ast::CallExpr *e, const std::string &dst, bool discard, bool tail = false);
+};
+
+#endif//PYTHON_INTERPRETER_CPPEMITTER_H
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_CPPRUNTIME_H
+#define PYTHON_INTERPRETER_CPPRUNTIME_H
+
+#include <bits/stdc++.h>
+#include <pthread.h>
+#include "Frames.h"
+#include "Output.h"
+#include "SmallInt.h"
+
+// Support code for programs translated by --emit-cpp (see CppEmitter). The
+// translation includes this header and links Value.cpp, Output.cpp and
+// Frames.cpp, so it computes with exactly the interpreter's Value operations.
+namespace aot {
+
+inline int depth = 0;
+
+// Guards one Python-level call: the interpreters' kMaxCallDepth holds here too.
+struct CallDepth {
+    bool active = true;
+    CallDepth() {
+        if (depth == kMaxCallDepth) throw std::runtime_error("maximum recursion depth exceeded");
+        ++depth;
+    }
+    ~CallDepth() { leave(); }
+    // `return f(...)` replaces the frame, as in the VMs, so the callee runs at this depth
+    void leave() {
+        if (active) --depth;
+        active = false;
+    }
+    CallDepth(const CallDepth &) = delete;
+    CallDepth &operator=(const CallDepth &) = delete;
+};
+
+[[noreturn]] inline void notAFunction(const char *name) {
+    throw std::runtime_error(std::string("'") + name + "' is not a function");
+}
+
+// Runs the module code on a thread with the tree-walking engines' 512 MB
+// stack, as Python calls are native calls here. An error ends the program
+// with status 1 after the output so far.
+inline int run(void (*module)()) {
+    struct Args {
+        void (*module)();
+        int status;
+    } args{module, 0};
+    auto body = [](void *p) -> void * {
+        auto *a = static_cast<Args *>(p);
+        try {
+            a->module();
+        } catch (const std::exception &e) {
+            Output::standard().flush();
+            std::cerr << "error: " << e.what() << '\n';
+            a->status = 1;
+        }
+        return nullptr;
+    };
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, size_t(512) << 20);
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, body, &args) != 0) body(&args);
+    else pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+    Output::standard().flush();
+    return args.status;
+}
+
+} // namespace aot
+
+#endif//PYTHON_INTERPRETER_CPPRUNTIME_H
@@ -0,0 +1,21 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_DISPATCH_H
+#define PYTHON_INTERPRETER_DISPATCH_H
+
+// Interpreter loops use direct threading (GCC/Clang labels-as-values) so that
+// every opcode ends in its own indirect jump. Configure with
+// -DPY_SWITCH_DISPATCH=ON to get the portable single-switch loop instead.
+#if defined(__GNUC__) && !defined(PY_SWITCH_DISPATCH)
+#define PY_THREADED_DISPATCH 1
+#endif
+
+#ifdef PY_THREADED_DISPATCH
+#define PY_DISPATCH_MODE "threaded"
+#define PY_LABEL_ADDR(name) &&op_##name,
+#define PY_TARGET(name) op_##name:
+#else
+#define PY_DISPATCH_MODE "switch"
+#define PY_TARGET(name) case Op::name:
+#endif
+
+#endif//PYTHON_INTERPRETER_DISPATCH_H
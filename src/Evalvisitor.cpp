@@ -1,21 +1,70 @@
 #include "Evalvisitor.h"
 #include <iostream>
 
-static Value toInt(const Value &v) {
-    if (v.type == Value::T_INT) return v;
-    return Value::None();
+Value &EvalVisitor::variable(antlr4::tree::TerminalNode *name) {
+    NameResolver::Slot slot = names.slot(name);
+    return slot.local ? frame[slot.index] : globals.at(slot.index);
 }
 
 std::any EvalVisitor::visitFile_input(Python3Parser::File_inputContext *ctx) {
-    // iterate statements
-    for (auto s : ctx->stmt()) visit(s);
+    names.resolve(ctx, globals);
+    callCaches.assign(names.tokenBound(), CallCache());
+    constantOf.assign(ctx->getStop()->getTokenIndex() + 1, -1);
+    formatOf.assign(ctx->getStop()->getTokenIndex() + 1, -1);
+    tailCallOf.assign(ctx->getStop()->getTokenIndex() + 1, nullptr);
+    std::unordered_map<std::string, int32_t> pool;
+    loadConstants(ctx, pool);
+    if (tailCalls) markTailCalls(ctx, false);
+    frames.reserve(names.maxFrameSize);
+    // iterate statements; a module-level return ends the program
+    for (auto s : ctx->stmt())
+        if (exec(s) == Completion::Return) break;
     return nullptr;
 }
 
+void EvalVisitor::loadConstants(antlr4::tree::ParseTree *node, std::unordered_map<std::string, int32_t> &pool) {
+    auto atom = dynamic_cast<Python3Parser::AtomContext *>(node);
+    if (!atom || (!atom->NUMBER() && atom->STRING().empty())) {
+        for (auto child : node->children) loadConstants(child, pool);
+        return;
+    }
+    // keyed on the source text, so an int and a string never collide
+    std::string text = atom->getText();
+    auto [it, inserted] = pool.try_emplace(text, int32_t(constants.size()));
+    if (inserted) {
+        if (atom->NUMBER()) {
+            if (text.find('.') != std::string::npos) constants.push_back(Value::fromFloat(std::stod(text)));
+            else constants.push_back(Value::fromInt(BigInt::fromString(text)));
+        } else {
+            // concatenate adjacent string pieces
+            std::string res;
+            for (auto s : atom->STRING()) res += s->getSymbol()->getText().substr(1, s->getSymbol()->getText().size()-2);
+            constants.push_back(Value::fromStr(res));
+        }
+    }
+    constantOf[atom->getStart()->getTokenIndex()] = it->second;
+}
+
+void EvalVisitor::markTailCalls(antlr4::tree::ParseTree *node, bool inDef) {
+    if (dynamic_cast<Python3Parser::FuncdefContext *>(node)) inDef = true;
+    auto ret = dynamic_cast<Python3Parser::Return_stmtContext *>(node);
+    if (!ret) {
+        for (auto child : node->children) markTailCalls(child, inDef);
+        return;
+    }
+    if (!inDef || !ret->testlist() || ret->testlist()->test().size() != 1) return;
+    // the value must be the call itself: test -> ... -> atom_expr(NAME, trailer)
+    antlr4::tree::ParseTree *t = ret->testlist()->test(0);
+    while (t->children.size() == 1) t = t->children[0];
+    auto call = dynamic_cast<Python3Parser::Atom_exprContext *>(t);
+    if (call && call->trailer() && call->atom()->NAME())
+        tailCallOf[ret->getStart()->getTokenIndex()] = call;
+}
+
 std::any EvalVisitor::visitStmt(Python3Parser::StmtContext *ctx) {
     if (ctx->simple_stmt()) return visit(ctx->simple_stmt());
     if (ctx->compound_stmt()) return visit(ctx->compound_stmt());
-    return nullptr;
+    return Completion::Normal;
 }
 
 std::any EvalVisitor::visitSimple_stmt(Python3Parser::Simple_stmtContext *ctx) {
@@ -23,9 +72,29 @@ std::any EvalVisitor::visitSimple_stmt(Python3Parser::Simple_stmtContext *ctx) {
 }
 
 std::any EvalVisitor::visitSmall_stmt(Python3Parser::Small_stmtContext *ctx) {
-    if (ctx->expr_stmt()) return visit(ctx->expr_stmt());
-    // ignore flow statements in minimal implementation
-    return nullptr;
+    if (ctx->expr_stmt()) {
+        visit(ctx->expr_stmt());
+        return Completion::Normal;
+    }
+    auto flow = ctx->flow_stmt();
+    if (flow->break_stmt()) return Completion::Break;
+    if (flow->continue_stmt()) return Completion::Continue;
+    auto ret = flow->return_stmt();
+    if (auto call = tailCallOf[ret->getStart()->getTokenIndex()]) {
+        CallCache &site = callSite(call->atom()->NAME(), call->trailer());
+        if (site.fn) {
+            // evaluated in this frame; a tail call among them has finished by the end
+            std::vector<Value> args;
+            args.reserve(site.args.size());
+            for (auto arg : site.args) args.push_back(std::any_cast<Value>(visit(arg)));
+            tailArgs = std::move(args);
+            tailSite = &site;
+            return Completion::TailCall;
+        }
+        if (site.builtin == Builtin::None) notAFunction(site, call->atom()->NAME());
+    }
+    retval = ret->testlist() ? std::any_cast<Value>(visit(ret->testlist())) : Value::None();
+    return Completion::Return;
 }
 
 std::any EvalVisitor::visitExpr_stmt(Python3Parser::Expr_stmtContext *ctx) {
@@ -43,8 +112,8 @@ std::any EvalVisitor::visitExpr_stmt(Python3Parser::Expr_stmtContext *ctx) {
         auto fa = te->factor(0);
         auto ae2 = fa->atom_expr();
         auto atom = ae2->atom();
-        std::string name = atom->NAME()->getSymbol()->getText();
-        Value lhs = env.count(name) ? env[name] : Value::fromInt(BigInt::fromLL(0));
+        Value &var = variable(atom->NAME());
+        Value lhs = var.type == Value::T_NONE ? Value::fromInt(BigInt::fromLL(0)) : var;
         Value rhs = std::any_cast<Value>(visit(lists.back()));
         auto op = ctx->augassign();
         Value res = lhs;
@@ -54,26 +123,24 @@ std::any EvalVisitor::visitExpr_stmt(Python3Parser::Expr_stmtContext *ctx) {
         else if (op->DIV_ASSIGN()) res = VDivFloat(lhs, rhs);
         else if (op->IDIV_ASSIGN()) res = VDivInt(lhs, rhs);
         else if (op->MOD_ASSIGN()) res = VMod(lhs, rhs);
-        env[name] = res;
+        var = res;
         return nullptr;
     }
     if (!ctx->ASSIGN().empty()) {
-        // Simple assignment: NAME = expr
-        auto lhs_list = lists[0];
-        auto rhs_list = lists.back();
-        Value vals = std::any_cast<Value>(visit(rhs_list));
-        Python3Parser::TestContext *t = lhs_list->test(0);
-        auto ot = t->or_test();
-        auto at = ot->and_test(0);
-        auto nt = at->not_test(0);
-        auto cmp = nt->comparison();
-        auto ae = cmp->arith_expr(0);
-        auto te = ae->term(0);
-        auto fa = te->factor(0);
-        auto ae2 = fa->atom_expr();
-        auto atom = ae2->atom();
-        std::string name = atom->NAME()->getSymbol()->getText();
-        env[name] = vals;
+        // t1 = t2 = ... = value; a target list of several names unpacks an
+        // equally long value list, every value evaluated before any is bound
+        std::vector<Value> vals;
+        for (auto t : lists.back()->test()) vals.push_back(std::any_cast<Value>(visit(t)));
+        for (size_t i = 0; i + 1 < lists.size(); ++i) {
+            auto targets = lists[i]->test();
+            if (targets.size() == 1) {
+                variable(chainName(targets[0])) = vals[0];
+                continue;
+            }
+            if (targets.size() != vals.size())
+                throw std::runtime_error("cannot unpack value into " + std::to_string(targets.size()) + " names");
+            for (size_t j = 0; j < targets.size(); ++j) variable(chainName(targets[j])) = vals[j];
+        }
         return nullptr;
     } else {
         // expression statement: evaluate and if it's a call to print, the printing happens in visitAtom_expr
@@ -85,57 +152,67 @@ std::any EvalVisitor::visitExpr_stmt(Python3Parser::Expr_stmtContext *ctx) {
 std::any EvalVisitor::visitCompound_stmt(Python3Parser::Compound_stmtContext *ctx) {
     if (ctx->if_stmt()) return visit(ctx->if_stmt());
     if (ctx->while_stmt()) return visit(ctx->while_stmt());
-    if (ctx->funcdef()) return nullptr; // functions not implemented in minimal subset
-    return nullptr;
+    if (ctx->funcdef()) define(ctx->funcdef());
+    return Completion::Normal;
+}
+
+// Binds the function's name; defaults are evaluated now, in the defining scope.
+void EvalVisitor::define(Python3Parser::FuncdefContext *ctx) {
+    const NameResolver::Function &info = names.functions.at(ctx);
+    Function &fn = functionPool.emplace_back(Function{ctx, &info, {}});
+    for (auto t : info.defaults) fn.defaults.push_back(std::any_cast<Value>(visit(t)));
+    functions[names.slot(ctx->NAME()).atom] = &fn;
+    ++bindingVersion;
 }
 std::any EvalVisitor::visitIf_stmt(Python3Parser::If_stmtContext *ctx) {
     // if test: suite (elif test: suite)* (else: suite)?
     for (size_t i=0;i<ctx->test().size();++i) {
         Value v = std::any_cast<Value>(visit(ctx->test(i)));
-        if (v.truthy()) { visit(ctx->suite(i)); return nullptr; }
+        if (v.truthy()) return visit(ctx->suite(i));
     }
     if (ctx->ELSE()) {
-        visit(ctx->suite(ctx->suite().size()-1));
+        return visit(ctx->suite(ctx->suite().size()-1));
     }
-    return nullptr;
+    return Completion::Normal;
 }
 std::any EvalVisitor::visitWhile_stmt(Python3Parser::While_stmtContext *ctx) {
     // while test: suite
-    int guard = 0; // avoid infinite loop in malformed input
     while (true) {
         Value v = std::any_cast<Value>(visit(ctx->test()));
         if (!v.truthy()) break;
-        visit(ctx->suite());
-        if (++guard > 1000000) break;
+        Completion c = exec(ctx->suite());
+        if (c == Completion::Break) break;
+        if (c == Completion::Return || c == Completion::TailCall) return c;
     }
-    return nullptr;
+    return Completion::Normal;
 }
 std::any EvalVisitor::visitSuite(Python3Parser::SuiteContext *ctx) {
     if (ctx->simple_stmt()) return visit(ctx->simple_stmt());
-    for (auto s : ctx->stmt()) visit(s);
-    return nullptr;
+    // the first statement that does not complete normally ends the suite
+    for (auto s : ctx->stmt()) {
+        Completion c = exec(s);
+        if (c != Completion::Normal) return c;
+    }
+    return Completion::Normal;
 }
 
 std::any EvalVisitor::visitTest(Python3Parser::TestContext *ctx) { return visit(ctx->or_test()); }
 std::any EvalVisitor::visitOr_test(Python3Parser::Or_testContext *ctx) {
-    // Evaluate left-to-right with short-circuit, return boolean Value
+    // Evaluate left-to-right with short-circuit; the result is the deciding operand
     Value cur = std::any_cast<Value>(visit(ctx->and_test(0)));
-    bool res = cur.truthy();
     for (size_t i=1; i<ctx->and_test().size(); ++i) {
-        if (res) break;
-        Value v = std::any_cast<Value>(visit(ctx->and_test(i)));
-        res = res || v.truthy();
+        if (cur.truthy()) break;
+        cur = std::any_cast<Value>(visit(ctx->and_test(i)));
     }
-    return Value::fromBool(res);
+    return cur;
 }
 std::any EvalVisitor::visitAnd_test(Python3Parser::And_testContext *ctx) {
-    bool res = true;
-    for (size_t i=0; i<ctx->not_test().size(); ++i) {
-        if (!res) break;
-        Value v = std::any_cast<Value>(visit(ctx->not_test(i)));
-        res = res && v.truthy();
+    Value cur = std::any_cast<Value>(visit(ctx->not_test(0)));
+    for (size_t i=1; i<ctx->not_test().size(); ++i) {
+        if (!cur.truthy()) break;
+        cur = std::any_cast<Value>(visit(ctx->not_test(i)));
     }
-    return Value::fromBool(res);
+    return cur;
 }
 std::any EvalVisitor::visitNot_test(Python3Parser::Not_testContext *ctx) {
     if (ctx->comparison()) return visit(ctx->comparison());
@@ -144,69 +221,27 @@ std::any EvalVisitor::visitNot_test(Python3Parser::Not_testContext *ctx) {
     return Value::fromBool(!v.truthy());
 }
 
-static int strCompare(const std::string &a, const std::string &b){ if (a<b) return -1; if (a>b) return 1; return 0; }
+static CmpOp compOp(Python3Parser::Comp_opContext *op) {
+    if (op->LESS_THAN()) return CmpOp::Lt;
+    if (op->GREATER_THAN()) return CmpOp::Gt;
+    if (op->EQUALS()) return CmpOp::Eq;
+    if (op->GT_EQ()) return CmpOp::Ge;
+    if (op->LT_EQ()) return CmpOp::Le;
+    return CmpOp::Ne;
+}
 
 std::any EvalVisitor::visitComparison(Python3Parser::ComparisonContext *ctx) {
-    // Handle chained comparisons: a op1 b op2 c ... -> all must be true
+    // Chained comparisons: a op1 b op2 c ... -> all must be true. Operands are
+    // evaluated one link ahead and at most once; the first false link stops it.
     size_t n = ctx->arith_expr().size();
-    std::vector<Value> vals; vals.reserve(n);
-    for (size_t i=0;i<n;++i) vals.push_back(std::any_cast<Value>(visit(ctx->arith_expr(i))));
-    auto cmp_op = [&](size_t i)->bool{
-        auto op = ctx->comp_op(i);
-        const Value &A = vals[i], &B = vals[i+1];
-        if (op->EQUALS() || op->NOT_EQ_2()) {
-            if (A.type == Value::T_STR || B.type == Value::T_STR) {
-                if (A.type != Value::T_STR || B.type != Value::T_STR) return op->NOT_EQ_2() != nullptr; // false for ==, true for !=
-                bool eq = (A.s == B.s); return op->EQUALS() ? eq : !eq;
-            }
-            if (A.type == Value::T_NONE || B.type == Value::T_NONE) {
-                bool eq = (A.type == Value::T_NONE && B.type == Value::T_NONE);
-                return op->EQUALS() ? eq : !eq;
-            }
-            if (A.type == Value::T_FLOAT || B.type == Value::T_FLOAT) {
-                double a = (A.type == Value::T_FLOAT) ? A.f : (A.type == Value::T_INT ? std::stod(A.i.toString()) : (A.type==Value::T_BOOL ? (A.b?1.0:0.0) : 0.0));
-                double b = (B.type == Value::T_FLOAT) ? B.f : (B.type == Value::T_INT ? std::stod(B.i.toString()) : (B.type==Value::T_BOOL ? (B.b?1.0:0.0) : 0.0));
-                bool eq = (a == b); return op->EQUALS() ? eq : !eq;
-            } else {
-                BigInt ai = (A.type == Value::T_INT) ? A.i : BigInt::fromLL(A.type==Value::T_BOOL && A.b ? 1 : 0);
-                BigInt bi = (B.type == Value::T_INT) ? B.i : BigInt::fromLL(B.type==Value::T_BOOL && B.b ? 1 : 0);
-                bool eq = (cmp(ai, bi) == 0); return op->EQUALS() ? eq : !eq;
-            }
-        } else {
-            if (A.type == Value::T_STR || B.type == Value::T_STR) {
-                if (A.type != Value::T_STR || B.type != Value::T_STR) return false;
-                int c = strCompare(A.s, B.s);
-                if (op->LESS_THAN()) return c < 0;
-                if (op->GREATER_THAN()) return c > 0;
-                if (op->LT_EQ()) return c <= 0;
-                if (op->GT_EQ()) return c >= 0;
-                return false;
-            }
-            if (A.type == Value::T_FLOAT || B.type == Value::T_FLOAT) {
-                double a = (A.type == Value::T_FLOAT) ? A.f : (A.type == Value::T_INT ? std::stod(A.i.toString()) : (A.type==Value::T_BOOL ? (A.b?1.0:0.0) : 0.0));
-                double b = (B.type == Value::T_FLOAT) ? B.f : (B.type == Value::T_INT ? std::stod(B.i.toString()) : (B.type==Value::T_BOOL ? (B.b?1.0:0.0) : 0.0));
-                if (op->LESS_THAN()) return a < b;
-                if (op->GREATER_THAN()) return a > b;
-                if (op->LT_EQ()) return a <= b;
-                if (op->GT_EQ()) return a >= b;
-                return false;
-            } else {
-                BigInt ai = (A.type == Value::T_INT) ? A.i : BigInt::fromLL(A.type==Value::T_BOOL && A.b ? 1 : 0);
-                BigInt bi = (B.type == Value::T_INT) ? B.i : BigInt::fromLL(B.type==Value::T_BOOL && B.b ? 1 : 0);
-                int c = cmp(ai, bi);
-                if (op->LESS_THAN()) return c < 0;
-                if (op->GREATER_THAN()) return c > 0;
-                if (op->LT_EQ()) return c <= 0;
-                if (op->GT_EQ()) return c >= 0;
-                return false;
-            }
-        }
-    };
-    bool all = true;
-    for (size_t i=0; i+1<n && i<ctx->comp_op().size(); ++i) {
-        if (!cmp_op(i)) { all=false; break; }
+    if (n == 1) return visit(ctx->arith_expr(0));
+    Value lhs = std::any_cast<Value>(visit(ctx->arith_expr(0)));
+    for (size_t i = 0; i + 1 < n; ++i) {
+        Value rhs = std::any_cast<Value>(visit(ctx->arith_expr(i + 1)));
+        if (!VCompare(compOp(ctx->comp_op(i)), lhs, rhs)) return Value::fromBool(false);
+        lhs = std::move(rhs);
     }
-    return Value::fromBool(all);
+    return Value::fromBool(true);
 }
 
 std::any EvalVisitor::visitArith_expr(Python3Parser::Arith_exprContext *ctx) {
@@ -243,80 +278,100 @@ std::any EvalVisitor::visitFactor(Python3Parser::FactorContext *ctx) {
     } else {
         // unary + or -
         Value v = std::any_cast<Value>(visit(ctx->factor()));
-        if (ctx->MINUS()) {
-            if (v.type == Value::T_INT) { BigInt t = v.i; t.neg = !t.neg; return Value::fromInt(t); }
-            if (v.type == Value::T_FLOAT) return Value::fromFloat(-v.f);
-        }
+        if (ctx->MINUS()) return VNeg(v);
         return v;
     }
 }
 
+EvalVisitor::CallCache &EvalVisitor::callSite(antlr4::tree::TerminalNode *callee, Python3Parser::TrailerContext *tr) {
+    CallCache &cache = callCaches[callee->getSymbol()->getTokenIndex()];
+    if (cache.version == bindingVersion) return cache;
+    cache.version = bindingVersion;
+    Atom atom = names.slot(callee).atom;
+    cache.builtin = AtomTable::builtinOf(atom);
+    int fn = cache.builtin == Builtin::None ? functions.find(atom) : -1;
+    cache.fn = fn >= 0 ? functions.at(fn) : nullptr;
+    cache.args.clear();
+    std::vector<std::string> keywords;
+    if (tr->arglist()) {
+        for (auto arg : tr->arglist()->argument()) {
+            auto tests = arg->test();
+            cache.args.push_back(tests.back());
+            keywords.push_back(tests.size() == 2 ? tests[0]->getText() : std::string());
+        }
+    }
+    if (cache.fn) cache.binding = bindArguments(cache.fn->info->name, cache.fn->info->params, cache.fn->defaults.size(), keywords);
+    return cache;
+}
+
+void EvalVisitor::completeFrame(Value *callee, const Function &fn, const ArgBinding &binding) {
+    static const Value none;
+    size_t size = fn.info->frameSize, numParams = fn.info->params.size();
+    size_t firstDefault = numParams - fn.defaults.size();
+    for (int p : binding.fromDefault) callee[p] = fn.defaults[p - firstDefault];
+    for (size_t i = numParams; i < size; ++i) callee[i] = none;
+}
+
+// Arguments are evaluated straight into the callee's frame, which is reserved
+// on the frame stack before any of them runs. A tail call made by the body
+// replaces the frame with its callee's and runs it at the same depth.
+Value EvalVisitor::call(const CallCache &site) {
+    const Function *fn = site.fn;
+    size_t size = fn->info->frameSize;
+    Value *callee = frames.push(size);
+    for (size_t i = 0; i < site.args.size(); ++i)
+        callee[site.binding.slotOfArg[i]] = std::any_cast<Value>(visit(site.args[i]));
+    completeFrame(callee, *fn, site.binding);
+    Value *caller = frame;
+    frame = callee;
+    Completion c = exec(fn->def->suite());
+    while (c == Completion::TailCall) {
+        const CallCache &next = *tailSite;
+        fn = next.fn;
+        frames.pop(size);
+        size = fn->info->frameSize;
+        frame = callee = frames.push(size); // the same base, as this was the top frame
+        for (size_t i = 0; i < tailArgs.size(); ++i) callee[next.binding.slotOfArg[i]] = std::move(tailArgs[i]);
+        completeFrame(callee, *fn, next.binding);
+        c = exec(fn->def->suite());
+    }
+    Value result;
+    if (c == Completion::Return) result = std::move(retval);
+    frame = caller;
+    frames.pop(size);
+    return result;
+}
+
 std::any EvalVisitor::visitAtom_expr(Python3Parser::Atom_exprContext *ctx) {
-    // If atom is a function name then base is None sentinel
-    Value base = std::any_cast<Value>(visit(ctx->atom()));
-    if (ctx->trailer()) {
-        auto tr = ctx->trailer();
-        // retrieve function name
-        auto atom = ctx->atom();
-        std::string fname;
-        if (atom->NAME()) fname = atom->NAME()->getSymbol()->getText();
-        if (fname == "print") {
+    auto atom = ctx->atom();
+    if (ctx->trailer() && atom->NAME()) {
+        CallCache &cache = callSite(atom->NAME(), ctx->trailer());
+        if (cache.builtin != Builtin::None) {
             std::vector<Value> args;
-            if (tr->arglist()) {
-                auto al = tr->arglist();
-                for (auto arg : al->argument()) {
-                    args.push_back(std::any_cast<Value>(visit(arg->test(0))));
-                }
-            }
-            for (size_t i=0;i<args.size();++i) {
-                if (i) std::cout << ' ';
-                std::cout << args[i].toString();
-            }
-            std::cout << '\n';
-            return Value::None();
-        } else if (fname == "int") {
-            Value a = Value::None();
-            if (tr->arglist()) a = std::any_cast<Value>(visit(tr->arglist()->argument(0)->test(0)));
-            if (a.type == Value::T_INT) return a;
-            if (a.type == Value::T_BOOL) return Value::fromInt(a.b?BigInt::fromLL(1):BigInt::fromLL(0));
-            if (a.type == Value::T_FLOAT) return Value::fromInt(BigInt::fromLL((long long)a.f));
-            if (a.type == Value::T_STR) return Value::fromInt(BigInt::fromString(a.s));
-            return Value::fromInt(BigInt::fromLL(0));
-        } else if (fname == "float") {
-            Value a = Value::None();
-            if (tr->arglist()) a = std::any_cast<Value>(visit(tr->arglist()->argument(0)->test(0)));
-            if (a.type == Value::T_FLOAT) return a;
-            if (a.type == Value::T_INT) return Value::fromFloat(0.0 + std::stod(a.i.toString()));
-            if (a.type == Value::T_BOOL) return Value::fromFloat(a.b?1.0:0.0);
-            if (a.type == Value::T_STR) return Value::fromFloat(std::stod(a.s));
-            return Value::fromFloat(0.0);
-        } else if (fname == "str") {
-            Value a = Value::None();
-            if (tr->arglist()) a = std::any_cast<Value>(visit(tr->arglist()->argument(0)->test(0)));
-            if (a.type == Value::T_STR) return a;
-            if (a.type == Value::T_INT) return Value::fromStr(a.i.toString());
-            if (a.type == Value::T_FLOAT) return Value::fromStr(Value::fromFloat(a.f).toString());
-            if (a.type == Value::T_BOOL) return Value::fromStr(a.b?"True":"False");
-            return Value::fromStr("None");
-        } else if (fname == "bool") {
-            Value a = Value::None();
-            if (tr->arglist()) a = std::any_cast<Value>(visit(tr->arglist()->argument(0)->test(0)));
-            return Value::fromBool(a.truthy());
+            args.reserve(cache.args.size());
+            for (auto arg : cache.args) args.push_back(std::any_cast<Value>(visit(arg)));
+            return VCallBuiltin(cache.builtin, args.data(), args.size());
         }
+        if (cache.fn) return call(cache);
+        notAFunction(cache, atom->NAME());
     }
-    return base;
+    // not a call: the value of the atom itself
+    return visit(atom);
+}
+
+// As in the VMs, the arguments run before the callee is found to be no function.
+void EvalVisitor::notAFunction(const CallCache &site, antlr4::tree::TerminalNode *callee) {
+    for (auto arg : site.args) visit(arg);
+    throw std::runtime_error("'" + callee->getSymbol()->getText() + "' is not a function");
 }
 
 std::any EvalVisitor::visitTrailer(Python3Parser::TrailerContext *ctx) { return nullptr; }
 
 std::any EvalVisitor::visitAtom(Python3Parser::AtomContext *ctx) {
-    if (ctx->NUMBER()) {
-        std::string s = ctx->NUMBER()->getSymbol()->getText();
-        if (s.find('.') != std::string::npos) {
-            return Value::fromFloat(std::stod(s));
-        }
-        return Value::fromInt(BigInt::fromString(s));
-    } else if (ctx->NONE()) {
+    // number and string literals come from the constant pool
+    int32_t k = constantOf[ctx->getStart()->getTokenIndex()];
+    if (k >= 0) return constants[k];
+    if (ctx->NONE()) {
         return Value::None();
     } else if (ctx->TRUE()) {
         return Value::fromBool(true);
@@ -324,18 +379,10 @@ std::any EvalVisitor::visitAtom(Python3Parser::AtomContext *ctx) {
         return Value::fromBool(false);
     } else if (ctx->OPEN_PAREN()) {
         return visit(ctx->test());
-    } else if (!ctx->STRING().empty()) {
-        // concatenate multiple adjacent strings
-        std::string res;
-        for (auto s : ctx->STRING()) res += s->getSymbol()->getText().substr(1, s->getSymbol()->getText().size()-2);
-        return Value::fromStr(res);
     } else if (ctx->format_string()) {
         return visit(ctx->format_string());
     } else if (ctx->NAME()) {
-        std::string name = ctx->NAME()->getSymbol()->getText();
-        auto it = env.find(name);
-        if (it != env.end()) return it->second;
-        return Value::None();
+        return variable(ctx->NAME());
     }
     return Value::None();
 }
@@ -347,62 +394,53 @@ std::any EvalVisitor::visitTestlist(Python3Parser::TestlistContext *ctx) {
 std::any EvalVisitor::visitArglist(Python3Parser::ArglistContext *ctx) { return nullptr; }
 
 std::any EvalVisitor::visitFormat_string(Python3Parser::Format_stringContext *ctx) {
-    // Build string by interleaving literals and evaluated expressions inside braces
-    std::string out;
-    size_t litN = ctx->FORMAT_STRING_LITERAL().size();
-    size_t exprN = ctx->testlist().size();
-    size_t i = 0;
-    for (; i < litN || i < exprN; ++i) {
-        if (i < litN) out += ctx->FORMAT_STRING_LITERAL(i)->getSymbol()->getText();
-        if (i < exprN) {
-            Value v = std::any_cast<Value>(visit(ctx->testlist(i)));
-            out += v.toString();
+    Value v;
+    v.type = Value::T_STR;
+    format(ctx, v.s);
+    return v;
+}
+
+EvalVisitor::FormatTemplate &EvalVisitor::formatTemplate(Python3Parser::Format_stringContext *ctx) {
+    int32_t &id = formatOf[ctx->getStart()->getTokenIndex()];
+    if (id >= 0) return formats[id];
+    id = int32_t(formats.size());
+    FormatTemplate &t = formats.emplace_back();
+    t.literals.emplace_back();
+    // literals and braced expressions in source order
+    for (auto child : ctx->children) {
+        if (auto tl = dynamic_cast<Python3Parser::TestlistContext *>(child)) {
+            // an f-string on its own in the braces: descend the single-child chain to it
+            antlr4::tree::ParseTree *node = tl->test().size() == 1 ? tl : nullptr;
+            while (node && node->children.size() == 1) node = node->children[0];
+            t.slots.push_back({tl, dynamic_cast<Python3Parser::Format_stringContext *>(node)});
+            t.literals.emplace_back();
+            continue;
+        }
+        auto term = dynamic_cast<antlr4::tree::TerminalNode *>(child);
+        if (!term || term->getSymbol()->getType() != Python3Parser::FORMAT_STRING_LITERAL) continue;
+        const std::string &raw = term->getSymbol()->getText();
+        std::string &literal = t.literals.back();
+        for (size_t i = 0; i < raw.size(); ++i) {
+            literal += raw[i];
+            if ((raw[i] == '{' || raw[i] == '}') && i + 1 < raw.size() && raw[i + 1] == raw[i]) ++i; // {{ / }}
         }
     }
-    return Value::fromStr(out);
+    for (auto &literal : t.literals) t.estimate += literal.size();
+    return t;
 }
 
-// helpers
-Value EvalVisitor::VAdd(const Value &a, const Value &b) {
-    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(a.i + b.i);
-    if (a.type == Value::T_FLOAT && b.type == Value::T_FLOAT) return Value::fromFloat(a.f + b.f);
-    if (a.type == Value::T_INT && b.type == Value::T_FLOAT) return Value::fromFloat(std::stod(a.i.toString()) + b.f);
-    if (a.type == Value::T_FLOAT && b.type == Value::T_INT) return Value::fromFloat(a.f + std::stod(b.i.toString()));
-    if (a.type == Value::T_STR && b.type == Value::T_STR) return Value::fromStr(a.s + b.s);
-    return Value::None();
-}
-Value EvalVisitor::VSub(const Value &a, const Value &b) {
-    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(a.i - b.i);
-    if (a.type == Value::T_FLOAT && b.type == Value::T_FLOAT) return Value::fromFloat(a.f - b.f);
-    if (a.type == Value::T_INT && b.type == Value::T_FLOAT) return Value::fromFloat(std::stod(a.i.toString()) - b.f);
-    if (a.type == Value::T_FLOAT && b.type == Value::T_INT) return Value::fromFloat(a.f - std::stod(b.i.toString()));
-    return Value::None();
-}
-Value EvalVisitor::VMul(const Value &a, const Value &b) {
-    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(a.i * b.i);
-    if (a.type == Value::T_FLOAT && b.type == Value::T_FLOAT) return Value::fromFloat(a.f * b.f);
-    if (a.type == Value::T_INT && b.type == Value::T_FLOAT) return Value::fromFloat(std::stod(a.i.toString()) * b.f);
-    if (a.type == Value::T_FLOAT && b.type == Value::T_INT) return Value::fromFloat(a.f * std::stod(b.i.toString()));
-    if (a.type == Value::T_STR && b.type == Value::T_INT) {
-        long long times = std::stoll(b.i.toString()); if (times < 0) times = 0;
-        std::string out; out.reserve(times * a.s.size());
-        for (long long i=0;i<times;++i) out += a.s;
-        return Value::fromStr(out);
+void EvalVisitor::format(Python3Parser::Format_stringContext *ctx, std::string &out) {
+    FormatTemplate &t = formatTemplate(ctx);
+    size_t start = out.size();
+    out.reserve(start + t.estimate);
+    for (size_t i = 0; i < t.slots.size(); ++i) {
+        out += t.literals[i];
+        if (t.slots[i].nested) {
+            format(t.slots[i].nested, out);
+            continue;
+        }
+        std::any_cast<Value>(visit(t.slots[i].expr)).appendTo(out);
     }
-    return Value::None();
-}
-Value EvalVisitor::VDivInt(const Value &a, const Value &b) {
-    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(divFloor(a.i, b.i));
-    return Value::None();
-}
-Value EvalVisitor::VDivFloat(const Value &a, const Value &b) {
-    double x=0.0,y=0.0; bool ok=true;
-    if (a.type == Value::T_FLOAT) x=a.f; else if (a.type == Value::T_INT) x = std::stod(a.i.toString()); else ok=false;
-    if (b.type == Value::T_FLOAT) y=b.f; else if (b.type == Value::T_INT) y = std::stod(b.i.toString()); else ok=false;
-    if (!ok) return Value::None();
-    return Value::fromFloat(x / y);
-}
-Value EvalVisitor::VMod(const Value &a, const Value &b) {
-    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(modFloor(a.i, b.i));
-    return Value::None();
+    out += t.literals.back();
+    t.estimate = std::max(t.estimate, out.size() - start);
 }
@@ -0,0 +1,38 @@
+#include "FlatMap.h"
+
+static uint32_t hashName(std::string_view s) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (unsigned char c : s) h = (h ^ c) * 16777619u;
+    return h;
+}
+
+AtomTable::AtomTable() {
+    table.assign(64, Probe{});
+    for (const char *b : {"print", "int", "float", "str", "bool"}) intern(b);
+}
+
+Atom AtomTable::intern(std::string_view name) {
+    uint32_t h = hashName(name);
+    size_t i = h & mask();
+    for (;; i = (i + 1) & mask()) {
+        const Probe &p = table[i];
+        if (p.atom < 0) break;
+        if (p.hash == h && names[p.atom] == name) return Atom(p.atom);
+    }
+    Atom a = Atom(names.size());
+    names.emplace_back(name);
+    table[i] = {h, int32_t(a)};
+    if (names.size() * 4 > table.size() * 3) grow();
+    return a;
+}
+
+void AtomTable::grow() {
+    std::vector<Probe> old(table.size() * 2);
+    table.swap(old);
+    for (const Probe &p : old) {
+        if (p.atom < 0) continue;
+        size_t i = p.hash & mask();
+        while (table[i].atom >= 0) i = (i + 1) & mask();
+        table[i] = p;
+    }
+}
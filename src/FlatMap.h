@@ -0,0 +1,105 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_FLATMAP_H
+#define PYTHON_INTERPRETER_FLATMAP_H
+
+#include <bits/stdc++.h>
+#include "Value.h"
+
+// Interned identifier. Atoms are dense, starting at 0, in order of first interning.
+using Atom = uint32_t;
+
+// Fibonacci hashing: the product's high bits mix in every bit of the atom,
+// so AtomMap takes its home slot from the top, not with a mask.
+inline uint32_t hashAtom(Atom a) { return a * 2654435769u; }
+
+// Open-addressing hash map keyed by Atom. The probe table holds only
+// (hash, entry index) pairs, so a lookup touches one cache line in the common
+// case; values live in a dense vector in insertion order and keep their index
+// for the life of the map, which lets resolved code address them directly.
+template <class V> class AtomMap {
+public:
+    AtomMap() { table.assign(8, Probe{}); }
+
+    size_t size() const { return entries.size(); }
+    V &at(int index) { return entries[index].second; }
+    const V &at(int index) const { return entries[index].second; }
+    Atom keyAt(int index) const { return entries[index].first; }
+
+    // entry index of key, or -1
+    int find(Atom key) const {
+        uint32_t h = hashAtom(key);
+        for (size_t i = home(h);; i = (i + 1) & mask()) {
+            const Probe &p = table[i];
+            if (p.index < 0) return -1;
+            if (p.hash == h && entries[p.index].first == key) return p.index;
+        }
+    }
+
+    // entry index of key, inserting `init` if absent
+    int insert(Atom key, V init = V()) {
+        uint32_t h = hashAtom(key);
+        size_t i = home(h);
+        for (;; i = (i + 1) & mask()) {
+            const Probe &p = table[i];
+            if (p.index < 0) break;
+            if (p.hash == h && entries[p.index].first == key) return p.index;
+        }
+        int index = int(entries.size());
+        entries.emplace_back(key, std::move(init));
+        table[i] = {h, index};
+        if (entries.size() * 4 > table.size() * 3) grow();
+        return index;
+    }
+
+    V &operator[](Atom key) { return at(insert(key)); }
+
+private:
+    struct Probe {
+        uint32_t hash = 0;
+        int32_t index = -1;
+    };
+    std::vector<Probe> table; // power-of-two size, at most 3/4 full
+    std::vector<std::pair<Atom, V>> entries;
+    int shift = 29; // 32 - log2(table.size())
+
+    size_t mask() const { return table.size() - 1; }
+    size_t home(uint32_t h) const { return h >> shift; }
+
+    void grow() {
+        std::vector<Probe> old(table.size() * 2);
+        table.swap(old);
+        --shift;
+        for (const Probe &p : old) {
+            if (p.index < 0) continue;
+            size_t i = home(p.hash);
+            while (table[i].index >= 0) i = (i + 1) & mask();
+            table[i] = p;
+        }
+    }
+};
+
+// Interns identifiers to atoms. Each entry keeps its precomputed hash so that
+// probing compares strings only on a full hash match. The builtin function
+// names are interned first, in Builtin order, so builtinOf is a range check.
+class AtomTable {
+public:
+    AtomTable();
+
+    Atom intern(std::string_view name);
+    const std::string &name(Atom a) const { return names[a]; }
+    size_t size() const { return names.size(); }
+    static Builtin builtinOf(Atom a) { return a < Atom(Builtin::None) ? Builtin(a) : Builtin::None; }
+
+private:
+    struct Probe {
+        uint32_t hash = 0;
+        int32_t atom = -1;
+    };
+    std::vector<Probe> table;
+    std::deque<std::string> names;
+
+    size_t mask() const { return table.size() - 1; }
+    void grow();
+};
+
+#endif//PYTHON_INTERPRETER_FLATMAP_H
@@ -0,0 +1,30 @@
+#include "Frames.h"
+
+ArgBinding bindArguments(const std::string &function, const std::vector<std::string> &params,
+                         size_t numDefaults, const std::vector<std::string> &keywords) {
+    ArgBinding binding;
+    std::vector<bool> bound(params.size(), false);
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        size_t slot = i;
+        if (!keywords[i].empty()) {
+            slot = std::find(params.begin(), params.end(), keywords[i]) - params.begin();
+            if (slot == params.size())
+                throw std::runtime_error(function + "() got an unexpected keyword argument '" + keywords[i] + "'");
+        } else if (slot >= params.size()) {
+            throw std::runtime_error(function + "() takes " + std::to_string(params.size()) + " positional arguments but " +
+                                     std::to_string(keywords.size()) + " were given");
+        }
+        if (bound[slot]) throw std::runtime_error(function + "() got multiple values for argument '" + params[slot] + "'");
+        bound[slot] = true;
+        binding.slotOfArg.push_back(int(slot));
+        if (slot != i) binding.inOrder = false;
+    }
+    size_t firstDefault = params.size() - numDefaults;
+    for (size_t p = 0; p < params.size(); ++p) {
+        if (bound[p]) continue;
+        if (p < firstDefault) throw std::runtime_error(function + "() missing required argument '" + params[p] + "'");
+        binding.fromDefault.push_back(int(p));
+        binding.inOrder = false;
+    }
+    return binding;
+}
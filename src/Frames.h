@@ -0,0 +1,56 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_FRAMES_H
+#define PYTHON_INTERPRETER_FRAMES_H
+
+#include <bits/stdc++.h>
+#include "Value.h"
+
+// The language guarantees at most 2000 nested user-function calls
+// (docs/grammar.md §10.2); frame storage is sized for that, with some
+// headroom, once up front.
+constexpr int kMaxCallDepth = 2048;
+
+// Where the arguments of one call site land in the callee's frame. It depends
+// only on the site's keyword names and the callee's parameter list, so every
+// engine computes it once per (site, function) and reuses it on later calls.
+struct ArgBinding {
+    std::vector<int> slotOfArg;   // parameter slot of each argument, in call order
+    std::vector<int> fromDefault; // parameter slots that take their default value
+    bool inOrder = true;          // argument i goes to slot i and nothing is defaulted
+};
+
+// Throws std::runtime_error for a missing, unknown or repeated argument.
+// `keywords` holds one entry per argument, empty for positional ones; the
+// last `numDefaults` parameters have defaults.
+ArgBinding bindArguments(const std::string &function, const std::vector<std::string> &params,
+                         size_t numDefaults, const std::vector<std::string> &keywords);
+
+// Contiguous storage for the local slots of every active call. Pushing and
+// popping a frame moves one index; no call allocates.
+class FrameStack {
+public:
+    void reserve(size_t maxFrameSize) {
+        slots.assign(maxFrameSize * kMaxCallDepth, Value());
+        top = 0;
+        depth = 0;
+    }
+    Value *push(size_t size) {
+        if (depth == kMaxCallDepth || top + size > slots.size())
+            throw std::runtime_error("maximum recursion depth exceeded");
+        Value *frame = slots.data() + top;
+        top += size;
+        ++depth;
+        return frame;
+    }
+    void pop(size_t size) {
+        top -= size;
+        --depth;
+    }
+
+private:
+    std::vector<Value> slots;
+    size_t top = 0;
+    int depth = 0;
+};
+
+#endif//PYTHON_INTERPRETER_FRAMES_H
@@ -0,0 +1,69 @@
+#include "Memo.h"
+
+// Float keys match on their bits: 0.0 and -0.0 give different results
+// (1 / x), and a NaN key has to match itself to ever be a hit.
+static uint64_t floatBits(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof bits);
+    return bits;
+}
+
+static size_t hashValue(const Value &v) {
+    size_t h = size_t(v.type) * 0x9e3779b97f4a7c15ULL;
+    switch (v.type) {
+        case Value::T_INT:
+            h ^= v.i.neg;
+            for (int d : v.i.d) h = (h ^ size_t(d)) * 0x100000001b3ULL;
+            return h;
+        case Value::T_FLOAT: return h ^ std::hash<uint64_t>()(floatBits(v.f));
+        case Value::T_BOOL: return h ^ v.b;
+        case Value::T_STR: return h ^ std::hash<std::string>()(v.s);
+        case Value::T_NONE: return h;
+    }
+    return h;
+}
+
+static bool sameValue(const Value &a, const Value &b) {
+    if (a.type != b.type) return false;
+    switch (a.type) {
+        case Value::T_INT: return cmp(a.i, b.i) == 0;
+        case Value::T_FLOAT: return floatBits(a.f) == floatBits(b.f);
+        case Value::T_BOOL: return a.b == b.b;
+        case Value::T_STR: return a.s == b.s;
+        case Value::T_NONE: return true;
+    }
+    return false;
+}
+
+size_t MemoTable::KeyHash::operator()(const std::vector<Value> &key) const {
+    size_t h = key.size();
+    for (auto &v : key) h = h * 31 + hashValue(v);
+    return h;
+}
+
+bool MemoTable::KeyEqual::operator()(const std::vector<Value> &a, const std::vector<Value> &b) const {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (!sameValue(a[i], b[i])) return false;
+    return true;
+}
+
+std::pair<std::optional<Value> *, bool> MemoTable::lookup(const Value *args, size_t n) {
+    auto [it, inserted] = results.try_emplace(std::vector<Value>(args, args + n));
+    if (it->second) {
+        ++hits;
+        return {&it->second, true};
+    }
+    ++misses;
+    // an empty entry that was already there belongs to a call still running
+    return {inserted ? &it->second : nullptr, false};
+}
+
+void printMemoReport(const std::deque<MemoTable> &tables, std::ostream &os) {
+    if (tables.empty()) os << "memo: no pure function was defined\n";
+    for (auto &t : tables) {
+        uint64_t calls = t.hits + t.misses;
+        os << "memo " << t.name << ": calls=" << calls << " hits=" << t.hits << " hit_rate="
+           << std::fixed << std::setprecision(1) << (calls ? 100.0 * t.hits / calls : 0.0) << "% entries=" << t.size() << '\n';
+    }
+}
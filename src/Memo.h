@@ -0,0 +1,39 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_MEMO_H
+#define PYTHON_INTERPRETER_MEMO_H
+
+#include <bits/stdc++.h>
+#include "Value.h"
+
+// Results of one pure def (see ast::pureFunctions), keyed on its bound
+// parameter values. Keys match only on equal type and value, so 1, 1.0 and
+// True are different keys.
+class MemoTable {
+public:
+    std::string name;
+    uint64_t hits = 0, misses = 0;
+
+    explicit MemoTable(std::string name) : name(std::move(name)) {}
+
+    // The result slot for the n parameter values at args, and whether it
+    // already holds a result. On a miss the caller fills the slot when the
+    // call returns; slots stay valid as the table grows. A call re-entered
+    // with the arguments of one still running gets a null slot and runs
+    // unmemoized, as the running call will fill the slot.
+    std::pair<std::optional<Value> *, bool> lookup(const Value *args, size_t n);
+    size_t size() const { return results.size(); }
+
+private:
+    struct KeyHash {
+        size_t operator()(const std::vector<Value> &key) const;
+    };
+    struct KeyEqual {
+        bool operator()(const std::vector<Value> &a, const std::vector<Value> &b) const;
+    };
+    std::unordered_map<std::vector<Value>, std::optional<Value>, KeyHash, KeyEqual> results; // empty while pending
+};
+
+// One line per table: calls, hits, hit rate and entries.
+void printMemoReport(const std::deque<MemoTable> &tables, std::ostream &os);
+
+#endif//PYTHON_INTERPRETER_MEMO_H
@@ -0,0 +1,93 @@
+#include "NameResolver.h"
+
+antlr4::tree::TerminalNode *chainName(antlr4::tree::ParseTree *t) {
+    while (t->children.size() == 1) t = t->children[0];
+    auto *term = dynamic_cast<antlr4::tree::TerminalNode *>(t);
+    if (term && term->getSymbol()->getType() == Python3Parser::NAME) return term;
+    return nullptr;
+}
+
+void NameResolver::resolve(Python3Parser::File_inputContext *tree, AtomMap<Value> &table) {
+    globals = &table;
+    collect(tree, nullptr);
+    walk(tree);
+    globals = nullptr;
+}
+
+// First pass: which names the module binds, and which each function assigns.
+void NameResolver::collect(antlr4::tree::ParseTree *node, std::vector<Atom> *into) {
+    if (auto fn = dynamic_cast<Python3Parser::FuncdefContext *>(node)) {
+        moduleNames.insert(atoms.intern(fn->NAME()->getSymbol()->getText()));
+        collect(fn->suite(), &assigned[fn]);
+        return;
+    }
+    if (auto es = dynamic_cast<Python3Parser::Expr_stmtContext *>(node)) {
+        auto lists = es->testlist();
+        size_t targets = es->augassign() ? 1 : lists.size() - 1;
+        for (size_t i = 0; i < targets; ++i) {
+            for (auto t : lists[i]->test()) {
+                auto name = chainName(t);
+                if (!name) continue;
+                Atom atom = atoms.intern(name->getSymbol()->getText());
+                if (into) into->push_back(atom);
+                else moduleNames.insert(atom);
+            }
+        }
+        return;
+    }
+    for (auto child : node->children) collect(child, into);
+}
+
+void NameResolver::walk(antlr4::tree::ParseTree *node) {
+    if (auto fn = dynamic_cast<Python3Parser::FuncdefContext *>(node)) {
+        function(fn);
+        return;
+    }
+    if (auto term = dynamic_cast<antlr4::tree::TerminalNode *>(node)) {
+        if (term->getSymbol()->getType() == Python3Parser::NAME) bind(term);
+        return;
+    }
+    for (auto child : node->children) walk(child);
+}
+
+// Parameters are numbered in declaration order, then the other locals;
+// defaults are evaluated in the enclosing scope, the body in the function's own.
+void NameResolver::function(Python3Parser::FuncdefContext *ctx) {
+    bind(ctx->NAME());
+    Function &fn = functions[ctx];
+    fn.name = ctx->NAME()->getSymbol()->getText();
+    AtomMap<int> frame;
+    auto args = ctx->parameters()->typedargslist();
+    if (args) {
+        for (auto t : args->test()) walk(t);
+        fn.defaults = args->test();
+        for (auto p : args->tfpdef()) {
+            fn.params.push_back(p->NAME()->getSymbol()->getText());
+            frame.insert(atoms.intern(fn.params.back()), int(frame.size()));
+        }
+    }
+    for (Atom a : assigned[ctx])
+        if (!moduleNames.count(a)) frame.insert(a, int(frame.size()));
+    fn.frameSize = int(frame.size());
+    maxFrameSize = std::max(maxFrameSize, fn.frameSize);
+    auto outer = locals;
+    locals = &frame;
+    if (args)
+        for (auto p : args->tfpdef()) bind(p->NAME());
+    walk(ctx->suite());
+    locals = outer;
+}
+
+void NameResolver::bind(antlr4::tree::TerminalNode *name) {
+    size_t at = name->getSymbol()->getTokenIndex();
+    if (slots.size() <= at) slots.resize(at + 1);
+    Atom atom = atoms.intern(name->getSymbol()->getText());
+    if (locals) {
+        int local = locals->find(atom);
+        if (local >= 0) {
+            slots[at] = {locals->at(local), atom, true};
+            return;
+        }
+    }
+    slots[at] = {globals->insert(atom, Value::None()), atom, false};
+}
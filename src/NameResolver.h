@@ -0,0 +1,60 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_NAMERESOLVER_H
+#define PYTHON_INTERPRETER_NAMERESOLVER_H
+
+#include <bits/stdc++.h>
+#include "Python3Parser.h"
+#include "FlatMap.h"
+#include "Value.h"
+
+// Resolves every NAME token of a parse tree to a variable slot before the
+// program runs, so that the visitor indexes an array instead of hashing the
+// identifier on each access. Identifiers are interned to atoms on the way.
+// A function's parameters, and the names it assigns that the module never
+// binds, get a slot in that function's frame (see Scope.h for the rules);
+// every other name is an entry of the global table.
+class NameResolver {
+public:
+    struct Slot {
+        int32_t index = -1; // frame slot if local, else entry index in the global table
+        Atom atom = 0;
+        bool local = false;
+    };
+
+    // per-function layout, fixed at resolve time
+    struct Function {
+        std::string name;
+        std::vector<std::string> params;                       // slots 0 .. params.size()-1
+        std::vector<Python3Parser::TestContext *> defaults; // for the trailing parameters
+        int frameSize = 0;
+    };
+
+    AtomTable atoms;
+    std::unordered_map<Python3Parser::FuncdefContext *, Function> functions;
+    int maxFrameSize = 0;
+
+    // Globals are entered into `globals` (initialised to None) as they are met.
+    void resolve(Python3Parser::File_inputContext *tree, AtomMap<Value> &globals);
+    // slot of a NAME terminal; the token must belong to the resolved tree
+    Slot slot(antlr4::tree::TerminalNode *name) const { return slots[name->getSymbol()->getTokenIndex()]; }
+    // one past the largest resolved token index
+    size_t tokenBound() const { return slots.size(); }
+
+private:
+    std::vector<Slot> slots; // indexed by token index
+    AtomMap<Value> *globals = nullptr;
+    const AtomMap<int> *locals = nullptr;
+    std::unordered_set<Atom> moduleNames;
+    std::unordered_map<Python3Parser::FuncdefContext *, std::vector<Atom>> assigned;
+
+    void collect(antlr4::tree::ParseTree *node, std::vector<Atom> *into);
+    void walk(antlr4::tree::ParseTree *node);
+    void function(Python3Parser::FuncdefContext *ctx);
+    void bind(antlr4::tree::TerminalNode *name);
+};
+
+// Descend a single-child chain (test -> ... -> atom) and return the NAME at its
+// end, or nullptr if the chain does not end in a NAME.
+antlr4::tree::TerminalNode *chainName(antlr4::tree::ParseTree *t);
+
+#endif//PYTHON_INTERPRETER_NAMERESOLVER_H
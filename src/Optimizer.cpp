@@ -0,0 +1,351 @@
+#include "Optimizer.h"
+
+using namespace ast;
+
+// longest string a fold may build; larger ones stay computed at run time
+static const size_t kMaxFoldedString = 4096;
+
+template <class T> Span<T> Optimizer::span(const std::vector<T> &v) {
+    Span<T> s;
+    if (v.empty()) return s;
+    s.data = static_cast<T *>(prog.arena.allocate(sizeof(T) * v.size(), alignof(T)));
+    s.size = uint32_t(v.size());
+    std::uninitialized_copy(v.begin(), v.end(), s.data);
+    return s;
+}
+
+static const char *binOpText(BinOp op) {
+    switch (op) {
+        case BinOp::Add: return "+";
+        case BinOp::Sub: return "-";
+        case BinOp::Mul: return "*";
+        case BinOp::Div: return "/";
+        case BinOp::IDiv: return "//";
+        case BinOp::Mod: return "%";
+    }
+    return "?";
+}
+
+static const char *cmpOpText(CmpOp op) {
+    switch (op) {
+        case CmpOp::Lt: return "<";
+        case CmpOp::Gt: return ">";
+        case CmpOp::Eq: return "==";
+        case CmpOp::Ge: return ">=";
+        case CmpOp::Le: return "<=";
+        case CmpOp::Ne: return "!=";
+    }
+    return "?";
+}
+
+static std::string operand(const Expr *e) {
+    bool compound = e->kind == Expr::Binary || e->kind == Expr::Compare || e->kind == Expr::And ||
+                    e->kind == Expr::Or || e->kind == Expr::Not;
+    return compound ? "(" + describe(e) + ")" : describe(e);
+}
+
+std::string describe(const Expr *e) {
+    switch (e->kind) {
+        case Expr::Const: {
+            const Value &v = static_cast<const ConstExpr *>(e)->value;
+            return v.type == Value::T_STR ? '"' + v.s + '"' : v.toString();
+        }
+        case Expr::Name: return std::string(static_cast<const NameExpr *>(e)->id);
+        case Expr::Neg: return "-" + operand(static_cast<const UnaryExpr *>(e)->operand);
+        case Expr::Not: return "not " + operand(static_cast<const UnaryExpr *>(e)->operand);
+        case Expr::Binary: {
+            auto be = static_cast<const BinaryExpr *>(e);
+            return operand(be->lhs) + " " + binOpText(be->op) + " " + operand(be->rhs);
+        }
+        case Expr::Compare: {
+            auto ce = static_cast<const CompareExpr *>(e);
+            std::string out = operand(ce->operands[0]);
+            for (uint32_t i = 0; i < ce->ops.size; ++i)
+                out += std::string(" ") + cmpOpText(ce->ops[i]) + " " + operand(ce->operands[i + 1]);
+            return out;
+        }
+        case Expr::And: case Expr::Or: {
+            auto le = static_cast<const LogicExpr *>(e);
+            std::string out;
+            for (uint32_t i = 0; i < le->operands.size; ++i)
+                out += (i ? (e->kind == Expr::And ? " and " : " or ") : "") + operand(le->operands[i]);
+            return out;
+        }
+        case Expr::Call: {
+            auto ce = static_cast<const CallExpr *>(e);
+            std::string out = std::string(ce->callee) + "(";
+            for (uint32_t i = 0; i < ce->args.size; ++i) {
+                if (i) out += ", ";
+                if (!ce->args[i].keyword.empty()) out += std::string(ce->args[i].keyword) + "=";
+                out += describe(ce->args[i].value);
+            }
+            return out + ")";
+        }
+        case Expr::FString: {
+            std::string out = "f\"";
+            for (auto &part : static_cast<const FStringExpr *>(e)->parts)
+                out += part.expr ? "{" + describe(part.expr) + "}" : std::string(part.literal);
+            return out + "\"";
+        }
+        case Expr::Tuple: {
+            std::string out;
+            for (auto o : static_cast<const TupleExpr *>(e)->elems) out += (out.empty() ? "" : ", ") + describe(o);
+            return out;
+        }
+    }
+    return "?";
+}
+
+void Optimizer::run() {
+    moduleNames = moduleBindings(prog.body);
+    countBindings(prog.body);
+    prog.body = block(prog.body, true);
+    if (remarks)
+        *remarks << "optimizer: folded=" << folded << " propagated=" << propagated << " branches=" << branches << '\n';
+}
+
+void Optimizer::countBindings(const Block &body) {
+    for (auto s : body) {
+        switch (s->kind) {
+            case Stmt::Assign:
+                for (auto &targets : static_cast<const AssignStmt *>(s)->targets)
+                    for (auto id : targets) ++bindings[id];
+                break;
+            case Stmt::AugAssign: ++bindings[static_cast<const AugAssignStmt *>(s)->target]; break;
+            case Stmt::If: {
+                auto is = static_cast<const IfStmt *>(s);
+                for (auto &br : is->branches) countBindings(br.body);
+                countBindings(is->orelse);
+                break;
+            }
+            case Stmt::While: countBindings(static_cast<const WhileStmt *>(s)->body); break;
+            case Stmt::FuncDef: {
+                auto fd = static_cast<const FuncDefStmt *>(s);
+                ++bindings[fd->name];
+                countBindings(fd->body);
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+// `module` is set only for the top level of the module, where a constant
+// assignment runs before every statement that follows it.
+Block Optimizer::block(const Block &body, bool module) {
+    std::vector<Stmt *> out;
+    for (auto s : body) stmt(s, module, out);
+    return span(out);
+}
+
+void Optimizer::stmt(Stmt *s, bool module, std::vector<Stmt *> &out) {
+    switch (s->kind) {
+        case Stmt::ExprS: {
+            auto es = static_cast<ExprStmt *>(s);
+            es->expr = expr(es->expr);
+            break;
+        }
+        case Stmt::Assign: {
+            auto as = static_cast<AssignStmt *>(s);
+            as->value = expr(as->value);
+            if (!module || as->value->kind != Expr::Const) break;
+            for (auto &targets : as->targets)
+                if (targets.size == 1 && bindings[targets[0]] == 1)
+                    known[targets[0]] = static_cast<const ConstExpr *>(as->value);
+            break;
+        }
+        case Stmt::AugAssign: {
+            auto as = static_cast<AugAssignStmt *>(s);
+            as->value = expr(as->value);
+            break;
+        }
+        case Stmt::If: {
+            auto is = static_cast<IfStmt *>(s);
+            std::vector<IfBranch> kept;
+            Block orelse = is->orelse;
+            bool decided = false;
+            for (auto &br : is->branches) {
+                Expr *cond = expr(br.cond);
+                if (cond->kind != Expr::Const) {
+                    kept.push_back({cond, block(br.body, false)});
+                    continue;
+                }
+                ++branches;
+                if (!static_cast<const ConstExpr *>(cond)->value.truthy()) {
+                    if (remarks) *remarks << "branch: if " << describe(br.cond) << " never taken, removed\n";
+                    continue;
+                }
+                // always taken: it ends the chain as its else
+                if (remarks) *remarks << "branch: if " << describe(br.cond) << " always taken, later branches removed\n";
+                orelse = block(br.body, false);
+                decided = true;
+                break;
+            }
+            if (!decided) orelse = block(orelse, false);
+            if (kept.empty()) {
+                out.insert(out.end(), orelse.begin(), orelse.end());
+                return;
+            }
+            is->branches = span(kept);
+            is->orelse = orelse;
+            break;
+        }
+        case Stmt::While: {
+            auto ws = static_cast<WhileStmt *>(s);
+            ws->cond = expr(ws->cond);
+            if (ws->cond->kind == Expr::Const && !static_cast<const ConstExpr *>(ws->cond)->value.truthy()) {
+                ++branches;
+                if (remarks) *remarks << "branch: while " << describe(ws->cond) << " never entered, removed\n";
+                return;
+            }
+            ws->body = block(ws->body, false);
+            break;
+        }
+        case Stmt::Return: {
+            auto rs = static_cast<ReturnStmt *>(s);
+            if (rs->value) rs->value = expr(rs->value);
+            break;
+        }
+        case Stmt::FuncDef: {
+            auto fd = static_cast<FuncDefStmt *>(s);
+            for (auto &p : fd->params)
+                if (p.defaultValue) p.defaultValue = expr(p.defaultValue);
+            auto names = functionLocals(fd, moduleNames);
+            std::unordered_set<std::string_view> locals(names.begin(), names.end());
+            auto outer = shadow;
+            shadow = &locals;
+            fd->body = block(fd->body, false);
+            shadow = outer;
+            break;
+        }
+        default: break;
+    }
+    out.push_back(s);
+}
+
+Expr *Optimizer::constant(Value v, const Expr *from) {
+    ++folded;
+    Expr *e = prog.arena.make<ConstExpr>(std::move(v));
+    if (remarks) *remarks << "fold: " << describe(from) << " -> " << describe(e) << '\n';
+    return e;
+}
+
+static const Value &valueOf(const Expr *e) { return static_cast<const ConstExpr *>(e)->value; }
+
+Expr *Optimizer::expr(Expr *e) {
+    // a fold that would throw (e.g. float() of a bad string) is left to run time
+    try {
+        switch (e->kind) {
+            case Expr::Name: {
+                auto id = static_cast<const NameExpr *>(e)->id;
+                if (shadow && shadow->count(id)) return e;
+                auto it = known.find(id);
+                if (it == known.end()) return e;
+                ++propagated;
+                if (remarks) *remarks << "propagate: " << id << " -> " << describe(it->second) << '\n';
+                return const_cast<ConstExpr *>(it->second);
+            }
+            case Expr::Neg: case Expr::Not: {
+                auto ue = static_cast<UnaryExpr *>(e);
+                ue->operand = expr(ue->operand);
+                if (ue->operand->kind != Expr::Const) return e;
+                const Value &v = valueOf(ue->operand);
+                return constant(e->kind == Expr::Neg ? VNeg(v) : Value::fromBool(!v.truthy()), e);
+            }
+            case Expr::Binary: {
+                auto be = static_cast<BinaryExpr *>(e);
+                be->lhs = expr(be->lhs);
+                be->rhs = expr(be->rhs);
+                if (be->lhs->kind != Expr::Const || be->rhs->kind != Expr::Const) return e;
+                const Value &a = valueOf(be->lhs), &b = valueOf(be->rhs);
+                if (be->op == BinOp::Mul && a.type == Value::T_STR && b.type == Value::T_INT && !a.s.empty() &&
+                    cmp(b.i, BigInt::fromLL(kMaxFoldedString / a.s.size())) > 0)
+                    return e;
+                return constant(VBinary(be->op, a, b), e);
+            }
+            case Expr::Compare: {
+                auto ce = static_cast<CompareExpr *>(e);
+                bool allConst = true;
+                for (auto &o : ce->operands) {
+                    o = expr(o);
+                    allConst = allConst && o->kind == Expr::Const;
+                }
+                if (!allConst) return e;
+                bool result = true;
+                for (uint32_t i = 0; i < ce->ops.size && result; ++i)
+                    result = VCompare(ce->ops[i], valueOf(ce->operands[i]), valueOf(ce->operands[i + 1]));
+                return constant(Value::fromBool(result), e);
+            }
+            case Expr::And: case Expr::Or: {
+                // a constant that decides the chain ends it; one that passes it on is dropped
+                auto le = static_cast<LogicExpr *>(e);
+                bool isAnd = e->kind == Expr::And;
+                std::vector<Expr *> kept;
+                for (uint32_t i = 0; i < le->operands.size; ++i) {
+                    Expr *o = expr(le->operands[i]);
+                    bool last = i + 1 == le->operands.size;
+                    if (o->kind == Expr::Const && !last && valueOf(o).truthy() == isAnd) continue;
+                    kept.push_back(o);
+                    if (o->kind == Expr::Const) break;
+                }
+                if (kept.size() == le->operands.size) {
+                    le->operands = span(kept);
+                    return e;
+                }
+                ++folded;
+                Expr *result = kept.size() == 1 ? kept[0] : nullptr;
+                if (!result) {
+                    auto *chain = prog.arena.make<LogicExpr>(e->kind);
+                    chain->operands = span(kept);
+                    result = chain;
+                }
+                if (remarks) *remarks << "fold: " << describe(e) << " -> " << describe(result) << '\n';
+                return result;
+            }
+            case Expr::Call: {
+                auto ce = static_cast<CallExpr *>(e);
+                for (auto &arg : ce->args) arg.value = expr(arg.value);
+                Builtin fn = builtinByName(ce->callee);
+                if (fn == Builtin::None || fn == Builtin::Print || ce->args.size != 1 || !ce->args[0].keyword.empty() ||
+                    ce->args[0].value->kind != Expr::Const)
+                    return e;
+                return constant(VCallBuiltin(fn, &valueOf(ce->args[0].value), 1), e);
+            }
+            case Expr::FString: {
+                // constant slots become literal text; adjacent literals merge
+                auto fe = static_cast<FStringExpr *>(e);
+                bool any = false;
+                for (auto &part : fe->parts) {
+                    if (!part.expr) continue;
+                    part.expr = expr(part.expr);
+                    any = any || part.expr->kind == Expr::Const;
+                }
+                if (!any) return e;
+                std::vector<FStringPart> parts;
+                std::string pending;
+                for (auto &part : fe->parts) {
+                    if (part.expr && part.expr->kind != Expr::Const) {
+                        if (!pending.empty()) parts.push_back({prog.arena.copy(pending), nullptr});
+                        pending.clear();
+                        parts.push_back(part);
+                        continue;
+                    }
+                    pending += part.expr ? valueOf(part.expr).toString() : std::string(part.literal);
+                }
+                if (parts.empty()) return constant(Value::fromStr(pending), e);
+                if (!pending.empty()) parts.push_back({prog.arena.copy(pending), nullptr});
+                ++folded;
+                if (remarks) *remarks << "fold: " << describe(e);
+                fe->parts = span(parts);
+                if (remarks) *remarks << " -> " << describe(e) << '\n';
+                return e;
+            }
+            case Expr::Tuple:
+                for (auto &o : static_cast<TupleExpr *>(e)->elems) o = expr(o);
+                return e;
+            default: return e;
+        }
+    } catch (const std::exception &) {
+        return e;
+    }
+}
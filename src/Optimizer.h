@@ -0,0 +1,49 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_OPTIMIZER_H
+#define PYTHON_INTERPRETER_OPTIMIZER_H
+
+#include <bits/stdc++.h>
+#include "Ast.h"
+#include "Scope.h"
+
+// Constant folding and propagation over an ast::Program, run before the
+// AST-based engines compile it:
+//  - operators, comparisons, `and`/`or`, f-strings and builtin conversions
+//    whose operands are constants are evaluated once, with the same Value
+//    functions the engines use;
+//  - a global assigned exactly once, at module level, to a constant is
+//    replaced by that constant in every read that runs after the assignment;
+//  - `if`/`elif` branches and `while` loops with a constant condition are
+//    resolved or dropped.
+class Optimizer {
+public:
+    // one line per rewrite when set (--opt-remarks)
+    std::ostream *remarks = nullptr;
+    size_t folded = 0, propagated = 0, branches = 0;
+
+    explicit Optimizer(ast::Program &program) : prog(program) {}
+    void run();
+
+private:
+    ast::Program &prog;
+    // number of statements binding each name anywhere in the program
+    std::unordered_map<std::string_view, int> bindings;
+    // propagated constants in effect at the statement being visited
+    std::unordered_map<std::string_view, const ast::ConstExpr *> known;
+    // locals of the def being visited, which shadow known globals
+    const std::unordered_set<std::string_view> *shadow = nullptr;
+    ast::NameSet moduleNames;
+
+    void countBindings(const ast::Block &body);
+    ast::Block block(const ast::Block &body, bool module);
+    // Appends the optimized form of s (zero or more statements) to out.
+    void stmt(ast::Stmt *s, bool module, std::vector<ast::Stmt *> &out);
+    ast::Expr *expr(ast::Expr *e);
+    ast::Expr *constant(Value v, const ast::Expr *from);
+    template <class T> ast::Span<T> span(const std::vector<T> &v);
+};
+
+// Source-like rendering of an expression, for remarks.
+std::string describe(const ast::Expr *e);
+
+#endif//PYTHON_INTERPRETER_OPTIMIZER_H
@@ -0,0 +1,81 @@
+#include "Output.h"
+#include <unistd.h>
+
+namespace {
+std::terminate_handler previousTerminate;
+}
+
+Output &Output::standard() {
+    static Output out;
+    return out;
+}
+
+Output::Output() {
+    // an uncaught error still shows the output printed before it
+    previousTerminate = std::set_terminate([] {
+        standard().flush();
+        if (previousTerminate) previousTerminate();
+        std::abort();
+    });
+}
+
+void Output::flush() {
+    size_t done = 0;
+    while (done < used) {
+        ssize_t n = ::write(STDOUT_FILENO, buf + done, used - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break; // nowhere to write to; drop the output like a closed stream
+        done += size_t(n);
+    }
+    used = 0;
+}
+
+void Output::put(std::string_view s) {
+    if (s.size() > kSize - used) {
+        flush();
+        if (s.size() >= kSize) {
+            // too big to buffer: straight out
+            for (size_t done = 0; done < s.size();) {
+                ssize_t n = ::write(STDOUT_FILENO, s.data() + done, s.size() - done);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return;
+                done += size_t(n);
+            }
+            return;
+        }
+    }
+    std::memcpy(buf + used, s.data(), s.size());
+    used += s.size();
+}
+
+void Output::put(const BigInt &x) {
+    size_t digits = 9 * x.d.size() + 1; // with the sign
+    if (digits > kSize) {
+        put(x.toString());
+        return;
+    }
+    char *p = reserve(digits), *start = p;
+    if (x.neg) *p++ = '-';
+    p = std::to_chars(p, p + 9, x.d.back()).ptr;
+    for (size_t i = x.d.size() - 1; i-- > 0;) {
+        // lower limbs are zero-padded to nine digits
+        unsigned limb = unsigned(x.d[i]);
+        for (int k = 8; k >= 0; --k, limb /= 10) p[k] = char('0' + limb % 10);
+        p += 9;
+    }
+    used += size_t(p - start);
+}
+
+void Output::put(const Value &v) {
+    switch (v.type) {
+        case Value::T_INT: put(v.i); break;
+        case Value::T_FLOAT: {
+            char *p = reserve(kFloatChars);
+            used += size_t(formatFloat(v.f, p) - p);
+            break;
+        }
+        case Value::T_BOOL: put(v.b ? std::string_view("True") : std::string_view("False")); break;
+        case Value::T_STR: put(std::string_view(v.s)); break;
+        case Value::T_NONE: put(std::string_view("None")); break;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_OUTPUT_H
+#define PYTHON_INTERPRETER_OUTPUT_H
+
+#include <bits/stdc++.h>
+#include "Value.h"
+
+// Standard output behind print. Values are formatted straight into one
+// 64 KiB buffer (BigInt limbs, fixed-6 floats, True/False/None, strings),
+// which goes to file descriptor 1 with write(2) when full, on flush() and
+// at exit or termination. Nothing passes through std::cout or stdio.
+class Output {
+public:
+    static Output &standard();
+
+    void put(char c) {
+        if (used == kSize) flush();
+        buf[used++] = c;
+    }
+    void put(std::string_view s);
+    void put(const Value &v);
+    void flush();
+
+    Output(const Output &) = delete;
+    Output &operator=(const Output &) = delete;
+
+private:
+    static constexpr size_t kSize = size_t(1) << 16;
+    char buf[kSize];
+    size_t used = 0;
+
+    Output();
+    ~Output() { flush(); }
+    // room for n more bytes (n <= kSize)
+    char *reserve(size_t n) {
+        if (kSize - used < n) flush();
+        return buf + used;
+    }
+    void put(const BigInt &x);
+};
+
+#endif//PYTHON_INTERPRETER_OUTPUT_H
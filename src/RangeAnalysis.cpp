@@ -0,0 +1,396 @@
+#include "RangeAnalysis.h"
+
+using namespace ast;
+
+namespace {
+
+constexpr long long kSmallMax = BigInt::BASE - 1;
+constexpr int kWidenAfter = 16; // rounds before a still-growing range is given up
+
+using Range = RangeAnalysis::Range;
+
+// Calls f on every name e reads.
+template <class F> void names(const Expr *e, F &&f) {
+    switch (e->kind) {
+        case Expr::Name: f(static_cast<const NameExpr *>(e)->id); break;
+        case Expr::Neg: case Expr::Not: names(static_cast<const UnaryExpr *>(e)->operand, f); break;
+        case Expr::Binary:
+            names(static_cast<const BinaryExpr *>(e)->lhs, f);
+            names(static_cast<const BinaryExpr *>(e)->rhs, f);
+            break;
+        case Expr::Compare:
+            for (auto o : static_cast<const CompareExpr *>(e)->operands) names(o, f);
+            break;
+        case Expr::And: case Expr::Or:
+            for (auto o : static_cast<const LogicExpr *>(e)->operands) names(o, f);
+            break;
+        case Expr::Call:
+            for (auto &arg : static_cast<const CallExpr *>(e)->args) names(arg.value, f);
+            break;
+        case Expr::FString:
+            for (auto &part : static_cast<const FStringExpr *>(e)->parts)
+                if (part.expr) names(part.expr, f);
+            break;
+        case Expr::Tuple:
+            for (auto o : static_cast<const TupleExpr *>(e)->elems) names(o, f);
+            break;
+        default: break;
+    }
+}
+
+// Calls f on every name s reads or binds; def bodies are entered only when
+// intoDefs is set.
+template <class F> void names(const Stmt *s, F &&f, bool intoDefs) {
+    auto block = [&](const Block &body) {
+        for (auto t : body) names(t, f, intoDefs);
+    };
+    switch (s->kind) {
+        case Stmt::ExprS: names(static_cast<const ExprStmt *>(s)->expr, f); break;
+        case Stmt::Assign: {
+            auto as = static_cast<const AssignStmt *>(s);
+            for (auto &targets : as->targets)
+                for (auto id : targets) f(id);
+            names(as->value, f);
+            break;
+        }
+        case Stmt::AugAssign: {
+            auto as = static_cast<const AugAssignStmt *>(s);
+            f(as->target);
+            names(as->value, f);
+            break;
+        }
+        case Stmt::If: {
+            auto is = static_cast<const IfStmt *>(s);
+            for (auto &br : is->branches) {
+                names(br.cond, f);
+                block(br.body);
+            }
+            block(is->orelse);
+            break;
+        }
+        case Stmt::While: {
+            auto ws = static_cast<const WhileStmt *>(s);
+            names(ws->cond, f);
+            block(ws->body);
+            break;
+        }
+        case Stmt::Return: {
+            auto rs = static_cast<const ReturnStmt *>(s);
+            if (rs->value) names(rs->value, f);
+            break;
+        }
+        case Stmt::FuncDef: {
+            auto fd = static_cast<const FuncDefStmt *>(s);
+            f(fd->name);
+            for (auto &p : fd->params)
+                if (p.defaultValue) names(p.defaultValue, f);
+            if (intoDefs) block(fd->body);
+            break;
+        }
+        default: break;
+    }
+}
+
+// Calls f on every def in body, nested ones included.
+template <class F> void defs(const Block &body, F &&f) {
+    for (auto s : body) {
+        switch (s->kind) {
+            case Stmt::If: {
+                auto is = static_cast<const IfStmt *>(s);
+                for (auto &br : is->branches) defs(br.body, f);
+                defs(is->orelse, f);
+                break;
+            }
+            case Stmt::While: defs(static_cast<const WhileStmt *>(s)->body, f); break;
+            case Stmt::FuncDef: {
+                auto fd = static_cast<const FuncDefStmt *>(s);
+                f(fd);
+                defs(fd->body, f);
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+// The bound e of a loop condition that requires `v < e` or `v <= e` (for an
+// increasing v) or `v > e` / `v >= e` (decreasing), else null.
+const Expr *loopBound(const Expr *cond, std::string_view v, bool increasing, CmpOp &cmp) {
+    if (cond->kind == Expr::And) {
+        for (auto o : static_cast<const LogicExpr *>(cond)->operands)
+            if (auto e = loopBound(o, v, increasing, cmp)) return e;
+        return nullptr;
+    }
+    if (cond->kind != Expr::Compare) return nullptr;
+    auto ce = static_cast<const CompareExpr *>(cond);
+    if (ce->ops.size != 1 || ce->operands[0]->kind != Expr::Name ||
+        static_cast<const NameExpr *>(ce->operands[0])->id != v)
+        return nullptr;
+    cmp = ce->ops[0];
+    bool ok = increasing ? cmp == CmpOp::Lt || cmp == CmpOp::Le : cmp == CmpOp::Gt || cmp == CmpOp::Ge;
+    return ok ? ce->operands[1] : nullptr;
+}
+
+int assignments(const Block &body, std::string_view v) {
+    int n = 0;
+    for (auto s : body) {
+        if (s->kind == Stmt::FuncDef) continue;
+        if (s->kind == Stmt::Assign) {
+            for (auto &targets : static_cast<const AssignStmt *>(s)->targets)
+                for (auto id : targets) n += id == v;
+        } else if (s->kind == Stmt::AugAssign) {
+            n += static_cast<const AugAssignStmt *>(s)->target == v;
+        } else if (s->kind == Stmt::If) {
+            auto is = static_cast<const IfStmt *>(s);
+            for (auto &br : is->branches) n += assignments(br.body, v);
+            n += assignments(is->orelse, v);
+        } else if (s->kind == Stmt::While) {
+            n += assignments(static_cast<const WhileStmt *>(s)->body, v);
+        }
+    }
+    return n;
+}
+
+long long floorDiv(long long a, long long b) {
+    long long q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+std::optional<Range> small(long long lo, long long hi) {
+    if (lo < -kSmallMax || hi > kSmallMax) return std::nullopt;
+    return Range{lo, hi};
+}
+
+std::optional<Range> arith(BinOp op, Range a, Range b) {
+    switch (op) {
+        case BinOp::Add: return small(a.lo + b.lo, a.hi + b.hi);
+        case BinOp::Sub: return small(a.lo - b.hi, a.hi - b.lo);
+        case BinOp::Mul: {
+            long long p[] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+            return small(*std::min_element(p, p + 4), *std::max_element(p, p + 4));
+        }
+        case BinOp::IDiv: {
+            if (b.lo < 1) return std::nullopt;
+            long long q[] = {floorDiv(a.lo, b.lo), floorDiv(a.lo, b.hi), floorDiv(a.hi, b.lo), floorDiv(a.hi, b.hi)};
+            return small(*std::min_element(q, q + 4), *std::max_element(q, q + 4));
+        }
+        case BinOp::Mod:
+            if (b.lo < 1) return std::nullopt;
+            return Range{0, b.hi - 1};
+        default: return std::nullopt; // `/` makes a float
+    }
+}
+
+} // namespace
+
+void RangeAnalysis::run() {
+    moduleNames = moduleBindings(prog.body);
+    analyze(prog.body, nullptr);
+    defs(prog.body, [&](const FuncDefStmt *fd) { analyze(fd->body, fd); });
+    if (remarks) {
+        for (auto &[fn, scope] : scopes) {
+            std::vector<std::pair<std::string_view, Range>> sorted(scope.proven.begin(), scope.proven.end());
+            std::sort(sorted.begin(), sorted.end(), [](auto &x, auto &y) { return x.first < y.first; });
+            for (auto &[id, r] : sorted)
+                *remarks << "range: " << id << " in [" << r.lo << ", " << r.hi << "] ("
+                         << (fn ? std::string(fn->name) : "<module>") << ")\n";
+        }
+    }
+}
+
+void RangeAnalysis::analyze(const Block &body, const FuncDefStmt *fn) {
+    Scope &scope = scopes[fn];
+    // candidates: the scope's own variables
+    NameSet candidates;
+    if (fn) {
+        for (auto id : functionLocals(fn, moduleNames)) candidates.insert(id);
+        for (auto &p : fn->params) candidates.erase(p.name);
+    } else {
+        candidates = moduleNames;
+        defs(body, [&](const FuncDefStmt *fd) {
+            candidates.erase(fd->name);
+            for (auto s : fd->body) names(s, [&](std::string_view id) { candidates.erase(id); }, true);
+        });
+    }
+    // each must first appear as the target of a top-level assignment
+    NameSet seen;
+    for (auto s : body) {
+        NameSet mentioned;
+        names(s, [&](std::string_view id) { mentioned.insert(id); }, false);
+        NameSet init;
+        if (s->kind == Stmt::Assign) {
+            auto as = static_cast<const AssignStmt *>(s);
+            NameSet read;
+            names(as->value, [&](std::string_view id) { read.insert(id); });
+            for (auto &targets : as->targets)
+                for (auto id : targets)
+                    if (!read.count(id)) init.insert(id);
+        }
+        for (auto id : mentioned) {
+            if (!candidates.count(id) || !seen.insert(id).second) continue;
+            if (!init.count(id)) candidates.erase(id);
+        }
+    }
+    // every assignment to a candidate, with the loop that bounds it if any
+    std::vector<const WhileStmt *> loops;
+    std::function<void(const Block &)> collect = [&](const Block &b) {
+        for (auto s : b) {
+            switch (s->kind) {
+                case Stmt::Assign: {
+                    auto as = static_cast<const AssignStmt *>(s);
+                    for (auto &targets : as->targets) {
+                        auto tuple = targets.size > 1 && as->value->kind == Expr::Tuple
+                                         ? static_cast<const TupleExpr *>(as->value) : nullptr;
+                        for (uint32_t i = 0; i < targets.size; ++i) {
+                            if (!candidates.count(targets[i])) continue;
+                            if (targets.size > 1 && (!tuple || tuple->elems.size != targets.size))
+                                candidates.erase(targets[i]);
+                            else
+                                scope.defs[targets[i]].push_back(Def{s, tuple ? tuple->elems[i] : as->value});
+                        }
+                    }
+                    break;
+                }
+                case Stmt::AugAssign: {
+                    auto as = static_cast<const AugAssignStmt *>(s);
+                    if (!candidates.count(as->target)) break;
+                    Def d{s, as->value};
+                    CmpOp cmp;
+                    if (!loops.empty() && (as->op == BinOp::Add || as->op == BinOp::Sub) &&
+                        loopBound(loops.back()->cond, as->target, as->op == BinOp::Add, cmp) &&
+                        assignments(loops.back()->body, as->target) == 1)
+                        d.counts = loops.back();
+                    scope.defs[as->target].push_back(d);
+                    break;
+                }
+                case Stmt::If: {
+                    auto is = static_cast<const IfStmt *>(s);
+                    for (auto &br : is->branches) collect(br.body);
+                    collect(is->orelse);
+                    break;
+                }
+                case Stmt::While:
+                    loops.push_back(static_cast<const WhileStmt *>(s));
+                    collect(loops.back()->body);
+                    loops.pop_back();
+                    break;
+                case Stmt::FuncDef:
+                    candidates.erase(static_cast<const FuncDefStmt *>(s)->name);
+                    break;
+                default: break;
+            }
+        }
+    };
+    collect(body);
+    for (auto it = scope.defs.begin(); it != scope.defs.end();)
+        it = candidates.count(it->first) ? std::next(it) : scope.defs.erase(it);
+
+    // Kleene iteration from "no values yet"; a candidate whose assignments
+    // leave the small range, or keep growing, is dropped
+    Ranges ranges;
+    auto contribution = [&](std::string_view v, const Def &d, bool &pending) -> std::optional<Range> {
+        if (d.stmt->kind == Stmt::Assign) return eval(d.value, scope, ranges, pending);
+        auto as = static_cast<const AugAssignStmt *>(d.stmt);
+        auto cur = ranges.find(v);
+        if (cur == ranges.end()) {
+            pending = true;
+            return std::nullopt;
+        }
+        auto step = eval(d.value, scope, ranges, pending);
+        if (!step) return std::nullopt;
+        if (!d.counts || step->lo < 0) return arith(as->op, cur->second, *step);
+        CmpOp cmp;
+        auto bound = eval(loopBound(d.counts->cond, v, as->op == BinOp::Add, cmp), scope, ranges, pending);
+        if (!bound) return std::nullopt;
+        if (as->op == BinOp::Add) {
+            long long top = (cmp == CmpOp::Lt ? bound->hi - 1 : bound->hi) + step->hi;
+            long long lo = cur->second.lo + step->lo;
+            return small(lo, std::max(lo, top));
+        }
+        long long bottom = (cmp == CmpOp::Gt ? bound->lo + 1 : bound->lo) - step->hi;
+        long long hi = cur->second.hi - step->lo;
+        return small(std::min(hi, bottom), hi);
+    };
+    for (int round = 0;; ++round) {
+        bool changed = false;
+        for (auto it = scope.defs.begin(); it != scope.defs.end();) {
+            std::string_view v = it->first;
+            std::optional<Range> acc;
+            bool top = false;
+            for (const Def &d : it->second) {
+                bool pending = false;
+                auto r = contribution(v, d, pending);
+                if (pending) continue;
+                if (!r) {
+                    top = true;
+                    break;
+                }
+                acc = acc ? Range{std::min(acc->lo, r->lo), std::max(acc->hi, r->hi)} : *r;
+            }
+            auto old = ranges.find(v);
+            bool grew = acc && (old == ranges.end() || acc->lo != old->second.lo || acc->hi != old->second.hi);
+            if (top || (grew && round >= kWidenAfter)) {
+                ranges.erase(v);
+                it = scope.defs.erase(it);
+                changed = true;
+                continue;
+            }
+            if (grew) {
+                ranges[v] = *acc;
+                changed = true;
+            }
+            ++it;
+        }
+        if (changed) continue;
+        // stable: a candidate still without a range only depends on dropped ones
+        for (auto it = scope.defs.begin(); it != scope.defs.end();) {
+            if (ranges.count(it->first)) {
+                ++it;
+                continue;
+            }
+            it = scope.defs.erase(it);
+            changed = true;
+        }
+        if (!changed) break;
+    }
+    scope.proven = std::move(ranges);
+}
+
+std::optional<Range> RangeAnalysis::eval(const Expr *e, const Scope &scope, const Ranges &ranges, bool &pending) const {
+    switch (e->kind) {
+        case Expr::Const: {
+            const Value &v = static_cast<const ConstExpr *>(e)->value;
+            if (v.type != Value::T_INT || v.i.d.size() != 1) return std::nullopt;
+            long long x = v.i.neg ? -(long long)v.i.d[0] : v.i.d[0];
+            return Range{x, x};
+        }
+        case Expr::Name: {
+            auto id = static_cast<const NameExpr *>(e)->id;
+            auto it = ranges.find(id);
+            if (it != ranges.end()) return it->second;
+            if (scope.defs.count(id)) pending = true;
+            return std::nullopt;
+        }
+        case Expr::Neg: {
+            auto r = eval(static_cast<const UnaryExpr *>(e)->operand, scope, ranges, pending);
+            if (!r) return std::nullopt;
+            return Range{-r->hi, -r->lo};
+        }
+        case Expr::Binary: {
+            auto be = static_cast<const BinaryExpr *>(e);
+            auto l = eval(be->lhs, scope, ranges, pending);
+            auto r = eval(be->rhs, scope, ranges, pending);
+            if (!l || !r) return std::nullopt;
+            return arith(be->op, *l, *r);
+        }
+        default: return std::nullopt;
+    }
+}
+
+std::optional<Range> RangeAnalysis::range(const Expr *e, const FuncDefStmt *scope) const {
+    auto it = scopes.find(scope);
+    if (it == scopes.end()) return std::nullopt;
+    bool pending = false;
+    auto r = eval(e, it->second, it->second.proven, pending);
+    return pending ? std::nullopt : r;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_RANGEANALYSIS_H
+#define PYTHON_INTERPRETER_RANGEANALYSIS_H
+
+#include <bits/stdc++.h>
+#include "Ast.h"
+#include "Scope.h"
+
+// Whole-program type and range inference for integer variables, run before
+// the register compiler. A variable of a scope (the module or one def, not a
+// parameter) is proven when
+//  - it is assigned at the top level of its scope before anything else in
+//    the scope mentions it, and, for a module variable, no def mentions it;
+//  - every assignment to it gives a small int (|v| < 1e9, one BigInt limb)
+//    by interval arithmetic over constants and other proven variables.
+// `v += c` (c >= 0) is bounded by the loop it counts: inside
+// `while v < e` / `v <= e`, as the only assignment to v in that body and
+// outside any inner loop, it cannot take v past max(e) + c. `v -= c` under
+// `while v > e` / `v >= e` is handled the same way.
+// Assignments that grow without such a bound are widened away, so the
+// variable stays on the generic path.
+class RangeAnalysis {
+public:
+    struct Range {
+        long long lo, hi;
+    };
+    using Ranges = std::unordered_map<std::string_view, Range>;
+
+    // one line per proven variable when set (--opt-remarks)
+    std::ostream *remarks = nullptr;
+
+    explicit RangeAnalysis(const ast::Program &program) : prog(program) {}
+    void run();
+
+    // Range of e evaluated in scope (nullptr: module code) when e can only be
+    // a small int, else nullopt.
+    std::optional<Range> range(const ast::Expr *e, const ast::FuncDefStmt *scope) const;
+
+private:
+    // an assignment to a candidate variable
+    struct Def {
+        const ast::Stmt *stmt;   // AssignStmt or AugAssignStmt
+        const ast::Expr *value;  // right-hand side (the tuple element for a, b = ...)
+        const ast::WhileStmt *counts = nullptr; // loop that bounds this += / -=
+    };
+    struct Scope {
+        Ranges proven;
+        std::unordered_map<std::string_view, std::vector<Def>> defs; // candidates
+    };
+
+    const ast::Program &prog;
+    ast::NameSet moduleNames;
+    std::unordered_map<const ast::FuncDefStmt *, Scope> scopes; // nullptr: the module
+
+    void analyze(const ast::Block &body, const ast::FuncDefStmt *fn);
+    // Range of e under ranges, where a candidate without one yet makes it empty.
+    std::optional<Range> eval(const ast::Expr *e, const Scope &scope, const Ranges &ranges, bool &pending) const;
+};
+
+#endif//PYTHON_INTERPRETER_RANGEANALYSIS_H
@@ -0,0 +1,78 @@
+#include "RegisterBytecode.h"
+
+namespace rb {
+
+const char *opName(Op op) {
+    static const char *const names[] = {
+#define RB_NAME(name) #name,
+        RB_OPCODES(RB_NAME)
+#undef RB_NAME
+    };
+    return names[int(op)];
+}
+
+void disassemble(const Chunk &chunk, std::ostream &os) {
+    const std::vector<std::string> *vars = &chunk.names;
+    auto reg = [&](int r) {
+        std::string s = "r" + std::to_string(r);
+        if (r < int(vars->size())) s += "(" + (*vars)[r] + ")";
+        return s;
+    };
+    auto global = [&](int g) { return "g" + std::to_string(g) + "(" + chunk.names[g] + ")"; };
+    size_t next = 0; // bodies follow the module code in definition order
+    for (size_t pc = 0; pc < chunk.code.size(); ++pc) {
+        if (next < chunk.functions.size() && chunk.functions[next].entry == int(pc)) {
+            const Function &fn = chunk.functions[next++];
+            vars = &fn.locals;
+            os << "\nfunction " << fn.name << "(";
+            for (size_t i = 0; i < fn.params.size(); ++i) os << (i ? ", " : "") << fn.params[i];
+            os << "), " << fn.numRegs << " registers\n";
+        }
+        const Instr &in = chunk.code[pc];
+        os << std::setw(5) << pc << "  " << std::left << std::setw(14) << opName(in.op) << std::right;
+        switch (in.op) {
+            case Op::LOADK: os << reg(in.a) << ", " << chunk.consts[in.b].toString(); break;
+            case Op::MOVE: case Op::NEG: case Op::NOT: os << reg(in.a) << ", " << reg(in.b); break;
+            case Op::LT_JMP: case Op::GT_JMP: case Op::EQ_JMP:
+            case Op::GE_JMP: case Op::LE_JMP: case Op::NE_JMP:
+            case Op::LT_JMP_SMALLINT: case Op::GT_JMP_SMALLINT: case Op::EQ_JMP_SMALLINT:
+            case Op::GE_JMP_SMALLINT: case Op::LE_JMP_SMALLINT: case Op::NE_JMP_SMALLINT:
+            case Op::LT_JMP_INT: case Op::GT_JMP_INT: case Op::EQ_JMP_INT:
+            case Op::GE_JMP_INT: case Op::LE_JMP_INT: case Op::NE_JMP_INT:
+                os << reg(in.a) << ", " << reg(in.b) << ", -> " << in.c; break;
+            case Op::ADDK: case Op::SUBK: case Op::MULK:
+            case Op::DIVK: case Op::IDIVK: case Op::MODK:
+            case Op::ADDK_INT: case Op::SUBK_INT: case Op::MULK_INT:
+            case Op::IDIVK_INT: case Op::MODK_INT:
+                os << reg(in.a) << ", " << reg(in.b) << ", " << chunk.consts[in.c].toString(); break;
+            case Op::LT_JMPK: case Op::GT_JMPK: case Op::EQ_JMPK:
+            case Op::GE_JMPK: case Op::LE_JMPK: case Op::NE_JMPK:
+            case Op::LT_JMPK_INT: case Op::GT_JMPK_INT: case Op::EQ_JMPK_INT:
+            case Op::GE_JMPK_INT: case Op::LE_JMPK_INT: case Op::NE_JMPK_INT:
+                os << reg(in.a) << ", " << chunk.consts[in.b].toString() << ", -> " << in.c; break;
+            case Op::MODK_EQ_JMP: case Op::MODK_NE_JMP:
+                os << reg(in.a) << ", " << chunk.consts[in.b].toString() << ", "
+                   << chunk.consts[in.b + 1].toString() << ", -> " << in.c;
+                break;
+            case Op::JMP: os << "-> " << in.c; break;
+            case Op::JMP_IF_FALSE: case Op::JMP_IF_TRUE: os << reg(in.a) << ", -> " << in.c; break;
+            case Op::CALL_BUILTIN: case Op::FORMAT:
+                os << reg(in.a) << ", " << reg(in.b) << ", argc " << in.c;
+                if (in.op == Op::CALL_BUILTIN) os << ", builtin " << int(in.aux);
+                break;
+            case Op::GETGLOBAL: os << reg(in.a) << ", " << global(in.b); break;
+            case Op::SETGLOBAL: os << global(in.a) << ", " << reg(in.b); break;
+            case Op::MAKE_FUNCTION: os << chunk.functions[in.a].name << ", defaults " << reg(in.b) << ", count " << in.c; break;
+            case Op::CALL: case Op::TAIL_CALL:
+                os << reg(in.a) << ", " << chunk.names[chunk.sites[in.c].global] << ", args " << reg(in.b)
+                   << ", argc " << chunk.sites[in.c].keywords.size();
+                break;
+            case Op::RET: os << reg(in.a); break;
+            case Op::HALT: break;
+            default: os << reg(in.a) << ", " << reg(in.b) << ", " << reg(in.c); break;
+        }
+        os << '\n';
+    }
+}
+
+} // namespace rb
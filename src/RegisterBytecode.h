@@ -0,0 +1,109 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_REGISTERBYTECODE_H
+#define PYTHON_INTERPRETER_REGISTERBYTECODE_H
+
+#include <bits/stdc++.h>
+#include "Value.h"
+
+// Three-address bytecode for the register VM (see RegisterVM). Variables and
+// temporaries live in one register file; r[a], r[b], r[c] name registers and
+// jump targets are always carried in c. The module's variables are its first
+// registers and double as the globals that function code reaches through
+// GETGLOBAL / SETGLOBAL.
+namespace rb {
+
+#define RB_OPCODES(X)                                                          \
+    X(LOADK)               /* r[a] = consts[b] */                              \
+    X(MOVE)                /* r[a] = r[b] */                                   \
+    X(GETGLOBAL)           /* r[a] = globals[b] */                             \
+    X(SETGLOBAL)           /* globals[a] = r[b] */                             \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(IDIV) X(MOD) /* r[a] = r[b] op r[c] */       \
+    X(NEG) X(NOT)          /* r[a] = op r[b] */                                \
+    X(LT) X(GT) X(EQ) X(GE) X(LE) X(NE)        /* r[a] = r[b] cmp r[c] */      \
+    X(LT_JMP) X(GT_JMP) X(EQ_JMP) X(GE_JMP) X(LE_JMP) X(NE_JMP)                \
+                           /* if !(r[a] cmp r[b]) goto c */                    \
+    /* superinstructions for loop idioms; k = consts */                        \
+    X(ADDK) X(SUBK) X(MULK) X(DIVK) X(IDIVK) X(MODK) /* r[a] = r[b] op k[c] */  \
+    X(LT_JMPK) X(GT_JMPK) X(EQ_JMPK) X(GE_JMPK) X(LE_JMPK) X(NE_JMPK)          \
+                           /* if !(r[a] cmp k[b]) goto c */                    \
+    X(MODK_EQ_JMP) X(MODK_NE_JMP)                                              \
+                           /* if !(r[a] % k[b] cmp k[b+1]) goto c */           \
+    X(JMP)                 /* goto c */                                        \
+    X(JMP_IF_FALSE)        /* if !r[a] goto c */                               \
+    X(JMP_IF_TRUE)         /* if r[a] goto c */                                \
+    X(CALL_BUILTIN)        /* r[a] = aux(r[b] .. r[b+c-1]) */                  \
+    X(FORMAT)              /* r[a] = str(r[b]) + ... + str(r[b+c-1]) */        \
+    X(MAKE_FUNCTION)       /* bind functions[a], defaults in r[b] .. r[b+c-1] */\
+    X(CALL)                /* r[a] = call through sites[c], args from r[b] */  \
+    X(TAIL_CALL)           /* CALL reusing the current window, then return */  \
+    X(RET)                 /* return r[a] to the caller */                     \
+    X(HALT)                                                                    \
+    /* Quickened forms: RegisterVM writes them over a generic op once its  */ \
+    /* operands have had one type, and back when a guard fails. SMALLINT   */ \
+    /* means an int of one BigInt limb, i.e. |v| < 1e9.                     */ \
+    X(ADD_SMALLINT) X(SUB_SMALLINT) X(MUL_SMALLINT)                            \
+    X(IDIV_SMALLINT) X(MOD_SMALLINT)                                           \
+    X(LT_SMALLINT) X(GT_SMALLINT) X(EQ_SMALLINT)                               \
+    X(GE_SMALLINT) X(LE_SMALLINT) X(NE_SMALLINT)                               \
+    X(LT_JMP_SMALLINT) X(GT_JMP_SMALLINT) X(EQ_JMP_SMALLINT)                   \
+    X(GE_JMP_SMALLINT) X(LE_JMP_SMALLINT) X(NE_JMP_SMALLINT)                   \
+    X(ADD_FLOAT) X(SUB_FLOAT) X(MUL_FLOAT) X(DIV_FLOAT)                        \
+    X(CONCAT_STR)          /* ADD of two strings */                            \
+    /* Proven forms: the compiler emits them where RangeAnalysis has shown */ \
+    /* both operands and the result to be small ints, so they skip every   */ \
+    /* type and overflow check. The K divisors are nonzero constants.      */ \
+    X(ADD_INT) X(SUB_INT) X(MUL_INT)                   /* r[a] = r[b] op r[c] */ \
+    X(ADDK_INT) X(SUBK_INT) X(MULK_INT) X(IDIVK_INT) X(MODK_INT)               \
+    X(LT_JMP_INT) X(GT_JMP_INT) X(EQ_JMP_INT)                                  \
+    X(GE_JMP_INT) X(LE_JMP_INT) X(NE_JMP_INT)                                  \
+    X(LT_JMPK_INT) X(GT_JMPK_INT) X(EQ_JMPK_INT)                               \
+    X(GE_JMPK_INT) X(LE_JMPK_INT) X(NE_JMPK_INT)
+
+enum class Op : uint8_t {
+#define RB_ENUM(name) name,
+    RB_OPCODES(RB_ENUM)
+#undef RB_ENUM
+};
+
+const char *opName(Op op);
+
+struct Instr {
+    Op op;
+    uint8_t aux = 0; // builtin id for CALL_BUILTIN
+    int32_t a = 0, b = 0, c = 0;
+};
+
+// A def. Its body is compiled after the module code, at `entry`, and runs
+// in a window of numRegs registers whose first ones hold its locals, params
+// first.
+struct Function {
+    std::string name;
+    int global;                      // register of the module the def binds
+    std::vector<std::string> params;
+    std::vector<std::string> locals;
+    int entry = 0;
+    int numRegs = 0;
+    bool pure = false;               // calls are memoized (--memoize)
+};
+
+// A user-function call: callee global and the keyword of each argument
+// (empty for positional ones).
+struct CallSite {
+    int global;
+    std::vector<std::string> keywords;
+};
+
+struct Chunk {
+    std::vector<Instr> code;
+    std::vector<Value> consts;
+    std::vector<std::string> names; // names[i] lives in r[i] of the module
+    std::vector<Function> functions;
+    std::vector<CallSite> sites;
+    int numRegs = 0; // of the module code
+};
+
+void disassemble(const Chunk &chunk, std::ostream &os);
+
+} // namespace rb
+
+#endif//PYTHON_INTERPRETER_REGISTERBYTECODE_H
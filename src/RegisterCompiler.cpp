@@ -0,0 +1,551 @@
+#include "RegisterCompiler.h"
+
+using namespace ast;
+using rb::Op;
+
+static Op binaryOp(BinOp op) {
+    switch (op) {
+        case BinOp::Add: return Op::ADD;
+        case BinOp::Sub: return Op::SUB;
+        case BinOp::Mul: return Op::MUL;
+        case BinOp::Div: return Op::DIV;
+        case BinOp::IDiv: return Op::IDIV;
+        case BinOp::Mod: return Op::MOD;
+    }
+    return Op::ADD;
+}
+
+static Op constantOp(BinOp op) {
+    static const Op ops[] = {Op::ADDK, Op::SUBK, Op::MULK, Op::DIVK, Op::IDIVK, Op::MODK};
+    return ops[int(op)];
+}
+
+static Op compareOp(CmpOp op, bool jump) {
+    static const Op value[] = {Op::LT, Op::GT, Op::EQ, Op::GE, Op::LE, Op::NE};
+    static const Op branch[] = {Op::LT_JMP, Op::GT_JMP, Op::EQ_JMP, Op::GE_JMP, Op::LE_JMP, Op::NE_JMP};
+    return (jump ? branch : value)[int(op)];
+}
+
+static Op compareConstantOp(CmpOp op) {
+    static const Op ops[] = {Op::LT_JMPK, Op::GT_JMPK, Op::EQ_JMPK, Op::GE_JMPK, Op::LE_JMPK, Op::NE_JMPK};
+    return ops[int(op)];
+}
+
+// the unchecked form of a generic op over proven small ints, or op itself
+static Op provenOp(Op op) {
+    switch (op) {
+        case Op::ADD: return Op::ADD_INT;
+        case Op::SUB: return Op::SUB_INT;
+        case Op::MUL: return Op::MUL_INT;
+        case Op::ADDK: return Op::ADDK_INT;
+        case Op::SUBK: return Op::SUBK_INT;
+        case Op::MULK: return Op::MULK_INT;
+        case Op::IDIVK: return Op::IDIVK_INT;
+        case Op::MODK: return Op::MODK_INT;
+        case Op::LT_JMP: return Op::LT_JMP_INT;
+        case Op::GT_JMP: return Op::GT_JMP_INT;
+        case Op::EQ_JMP: return Op::EQ_JMP_INT;
+        case Op::GE_JMP: return Op::GE_JMP_INT;
+        case Op::LE_JMP: return Op::LE_JMP_INT;
+        case Op::NE_JMP: return Op::NE_JMP_INT;
+        case Op::LT_JMPK: return Op::LT_JMPK_INT;
+        case Op::GT_JMPK: return Op::GT_JMPK_INT;
+        case Op::EQ_JMPK: return Op::EQ_JMPK_INT;
+        case Op::GE_JMPK: return Op::GE_JMPK_INT;
+        case Op::LE_JMPK: return Op::LE_JMPK_INT;
+        case Op::NE_JMPK: return Op::NE_JMPK_INT;
+        default: return op;
+    }
+}
+
+rb::Chunk RegisterCompiler::compile(const Program &program) {
+    chunk = rb::Chunk();
+    moduleNames = moduleBindings(program.body);
+    if (memoize) memoized = pureFunctions(program.body);
+    collectNames(program.body, nullptr);
+    numVars = temp = peak = int(chunk.names.size());
+    scope = nullptr;
+    block(program.body);
+    emit(Op::HALT);
+    chunk.numRegs = peak;
+    // function bodies follow the module code; compiling one may queue nested defs
+    for (size_t i = 0; i < pending.size(); ++i) functionBody(pending[i].first, pending[i].second);
+    pending.clear();
+    moduleNames.clear();
+    memoized.clear();
+    return std::move(chunk);
+}
+
+void RegisterCompiler::functionBody(const FuncDefStmt *fd, int index) {
+    locals.clear();
+    for (auto id : functionLocals(fd, moduleNames)) {
+        locals.emplace(id, int(locals.size()));
+        chunk.functions[index].locals.emplace_back(id);
+    }
+    chunk.functions[index].entry = here();
+    inFunction = true;
+    scope = fd;
+    numVars = temp = peak = int(locals.size());
+    block(fd->body);
+    int none = newTemp();
+    emit(Op::LOADK, none, constant(Value::None()));
+    emit(Op::RET, none);
+    chunk.functions[index].numRegs = peak;
+    inFunction = false;
+}
+
+int RegisterCompiler::emit(Op op, int a, int b, int c, int aux) {
+    rb::Instr in;
+    in.op = op; in.aux = uint8_t(aux); in.a = a; in.b = b; in.c = c;
+    chunk.code.push_back(in);
+    return here() - 1;
+}
+
+int RegisterCompiler::newTemp() {
+    peak = std::max(peak, temp + 1);
+    return temp++;
+}
+
+int RegisterCompiler::var(std::string_view id) {
+    auto it = vars.find(id);
+    if (it != vars.end()) return it->second;
+    chunk.names.emplace_back(id);
+    return vars[id] = int(chunk.names.size()) - 1;
+}
+
+int RegisterCompiler::local(std::string_view id) const {
+    if (!inFunction) return -1;
+    auto it = locals.find(id);
+    return it != locals.end() ? it->second : -1;
+}
+
+int RegisterCompiler::target(std::string_view id) {
+    if (!inFunction) return var(id);
+    int r = local(id);
+    return r >= 0 ? r : newTemp();
+}
+
+void RegisterCompiler::assignTo(std::string_view id, int reg) {
+    if (inFunction && local(id) < 0) emit(Op::SETGLOBAL, var(id), reg);
+}
+
+int RegisterCompiler::pin(int reg, const Expr *later) {
+    if (inFunction || reg >= numVars || !callsFunction(later)) return reg;
+    int t = newTemp();
+    emit(Op::MOVE, t, reg);
+    return t;
+}
+
+int RegisterCompiler::constant(const Value &v) {
+    chunk.consts.push_back(v);
+    return int(chunk.consts.size()) - 1;
+}
+
+const ConstExpr *RegisterCompiler::literal(const Expr *e) const {
+    return superinstructions && e->kind == Expr::Const ? static_cast<const ConstExpr *>(e) : nullptr;
+}
+
+bool RegisterCompiler::provenInt(const Expr *e) const {
+    return ranges && ranges->range(e, scope);
+}
+
+void RegisterCompiler::binary(BinOp op, int dst, int l, const Expr *rhs, bool proven) {
+    if (auto k = literal(rhs)) {
+        Op kop = constantOp(op);
+        emit(proven ? provenOp(kop) : kop, dst, l, constant(k->value));
+        return;
+    }
+    int r = expr(rhs);
+    emit(proven ? provenOp(binaryOp(op)) : binaryOp(op), dst, l, r);
+}
+
+// Globals are numbered before any temporary so that they keep fixed registers;
+// names local to a def (in skip) are left to that def's own numbering.
+void RegisterCompiler::collectNames(const Block &body, const NameSet *skip) {
+    auto name = [&](std::string_view id) {
+        if (!skip || !skip->count(id)) var(id);
+    };
+    for (auto s : body) {
+        switch (s->kind) {
+            case Stmt::ExprS: collectNames(static_cast<const ExprStmt *>(s)->expr, skip); break;
+            case Stmt::Assign: {
+                auto as = static_cast<const AssignStmt *>(s);
+                for (auto &targets : as->targets)
+                    for (auto id : targets) name(id);
+                collectNames(as->value, skip);
+                break;
+            }
+            case Stmt::AugAssign: {
+                auto as = static_cast<const AugAssignStmt *>(s);
+                name(as->target);
+                collectNames(as->value, skip);
+                break;
+            }
+            case Stmt::If: {
+                auto is = static_cast<const IfStmt *>(s);
+                for (auto &br : is->branches) { collectNames(br.cond, skip); collectNames(br.body, skip); }
+                collectNames(is->orelse, skip);
+                break;
+            }
+            case Stmt::While: {
+                auto ws = static_cast<const WhileStmt *>(s);
+                collectNames(ws->cond, skip);
+                collectNames(ws->body, skip);
+                break;
+            }
+            case Stmt::Return: {
+                auto rs = static_cast<const ReturnStmt *>(s);
+                if (rs->value) collectNames(rs->value, skip);
+                break;
+            }
+            case Stmt::FuncDef: {
+                auto fd = static_cast<const FuncDefStmt *>(s);
+                var(fd->name);
+                for (auto &p : fd->params)
+                    if (p.defaultValue) collectNames(p.defaultValue, skip);
+                auto names = functionLocals(fd, moduleNames);
+                NameSet inner(names.begin(), names.end());
+                collectNames(fd->body, &inner);
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+void RegisterCompiler::collectNames(const Expr *e, const NameSet *skip) {
+    auto name = [&](std::string_view id) {
+        if (!skip || !skip->count(id)) var(id);
+    };
+    switch (e->kind) {
+        case Expr::Name: name(static_cast<const NameExpr *>(e)->id); break;
+        case Expr::Neg: case Expr::Not: collectNames(static_cast<const UnaryExpr *>(e)->operand, skip); break;
+        case Expr::Binary:
+            collectNames(static_cast<const BinaryExpr *>(e)->lhs, skip);
+            collectNames(static_cast<const BinaryExpr *>(e)->rhs, skip);
+            break;
+        case Expr::Compare:
+            for (auto o : static_cast<const CompareExpr *>(e)->operands) collectNames(o, skip);
+            break;
+        case Expr::And: case Expr::Or:
+            for (auto o : static_cast<const LogicExpr *>(e)->operands) collectNames(o, skip);
+            break;
+        case Expr::Call: {
+            auto ce = static_cast<const CallExpr *>(e);
+            if (builtinByName(ce->callee) == Builtin::None) var(ce->callee);
+            for (auto &arg : ce->args) collectNames(arg.value, skip);
+            break;
+        }
+        case Expr::FString:
+            for (auto &part : static_cast<const FStringExpr *>(e)->parts)
+                if (part.expr) collectNames(part.expr, skip);
+            break;
+        case Expr::Tuple:
+            for (auto o : static_cast<const TupleExpr *>(e)->elems) collectNames(o, skip);
+            break;
+        default: break;
+    }
+}
+
+void RegisterCompiler::block(const Block &body) {
+    for (auto s : body) {
+        stmt(s);
+        temp = numVars;
+    }
+}
+
+void RegisterCompiler::stmt(const Stmt *s) {
+    switch (s->kind) {
+        case Stmt::ExprS:
+            expr(static_cast<const ExprStmt *>(s)->expr);
+            break;
+        case Stmt::Assign: {
+            auto as = static_cast<const AssignStmt *>(s);
+            if (as->targets.size == 1 && as->targets[0].size > 1) {
+                // a, b = x, y: evaluate every value into temporaries, then bind
+                auto &names = as->targets[0];
+                auto *tuple = as->value->kind == Expr::Tuple ? static_cast<const TupleExpr *>(as->value) : nullptr;
+                if (!tuple || tuple->elems.size != names.size)
+                    throw std::runtime_error("cannot unpack value into " + std::to_string(names.size) + " names");
+                std::vector<int> regs;
+                for (auto e : tuple->elems) regs.push_back(expr(e, newTemp()));
+                for (uint32_t i = 0; i < names.size; ++i) {
+                    int r = local(names[i]);
+                    if (inFunction && r < 0) emit(Op::SETGLOBAL, var(names[i]), regs[i]);
+                    else emit(Op::MOVE, inFunction ? r : var(names[i]), regs[i]);
+                }
+                break;
+            }
+            int first = target(as->targets[0][0]);
+            expr(as->value, first);
+            assignTo(as->targets[0][0], first);
+            for (uint32_t i = 1; i < as->targets.size; ++i) {
+                auto id = as->targets[i][0];
+                if (inFunction && local(id) < 0) emit(Op::SETGLOBAL, var(id), first);
+                else emit(Op::MOVE, inFunction ? local(id) : var(id), first);
+            }
+            break;
+        }
+        case Stmt::AugAssign: {
+            auto as = static_cast<const AugAssignStmt *>(s);
+            if (inFunction && local(as->target) < 0) {
+                int g = var(as->target), t = newTemp();
+                emit(Op::GETGLOBAL, t, g);
+                binary(as->op, t, t, as->value);
+                emit(Op::SETGLOBAL, g, t);
+                break;
+            }
+            int r = inFunction ? local(as->target) : var(as->target);
+            NameExpr self(as->target);
+            BinaryExpr update(as->op, &self, as->value);
+            binary(as->op, r, pin(r, as->value), as->value, provenInt(&update));
+            break;
+        }
+        case Stmt::If: {
+            auto is = static_cast<const IfStmt *>(s);
+            std::vector<int> ends;
+            for (uint32_t i = 0; i < is->branches.size; ++i) {
+                auto &br = is->branches[i];
+                auto skips = branchIfFalse(br.cond);
+                temp = numVars;
+                block(br.body);
+                // the last branch without an else falls through to the end
+                if (i + 1 < is->branches.size || !is->orelse.empty()) ends.push_back(emit(Op::JMP));
+                for (int at : skips) patch(at, here());
+            }
+            block(is->orelse);
+            for (int at : ends) patch(at, here());
+            break;
+        }
+        case Stmt::While: {
+            auto ws = static_cast<const WhileStmt *>(s);
+            loops.push_back({here(), {}});
+            auto exits = branchIfFalse(ws->cond);
+            temp = numVars;
+            block(ws->body);
+            emit(Op::JMP, 0, 0, loops.back().start);
+            for (int at : exits) patch(at, here());
+            for (int at : loops.back().breaks) patch(at, here());
+            loops.pop_back();
+            break;
+        }
+        case Stmt::Break:
+            if (!loops.empty()) loops.back().breaks.push_back(emit(Op::JMP));
+            break;
+        case Stmt::Continue:
+            if (!loops.empty()) emit(Op::JMP, 0, 0, loops.back().start);
+            break;
+        case Stmt::Return: {
+            if (!inFunction) {
+                emit(Op::HALT); // a module-level return ends the program
+                break;
+            }
+            auto rs = static_cast<const ReturnStmt *>(s);
+            if (tailCalls && rs->value && rs->value->kind == Expr::Call &&
+                builtinByName(static_cast<const CallExpr *>(rs->value)->callee) == Builtin::None) {
+                call(static_cast<const CallExpr *>(rs->value), -1, true);
+                break;
+            }
+            int r;
+            if (rs->value) {
+                r = expr(rs->value);
+            } else {
+                r = newTemp();
+                emit(Op::LOADK, r, constant(Value::None()));
+            }
+            emit(Op::RET, r);
+            break;
+        }
+        case Stmt::FuncDef: {
+            auto fd = static_cast<const FuncDefStmt *>(s);
+            rb::Function fn;
+            fn.name = std::string(fd->name);
+            fn.global = var(fd->name);
+            fn.pure = memoized.count(fd->name) > 0;
+            int base = temp, defaults = 0;
+            for (auto &p : fd->params) {
+                fn.params.emplace_back(p.name);
+                if (p.defaultValue) expr(p.defaultValue, newTemp()), ++defaults;
+            }
+            chunk.functions.push_back(std::move(fn));
+            int index = int(chunk.functions.size()) - 1;
+            pending.emplace_back(fd, index);
+            emit(Op::MAKE_FUNCTION, index, base, defaults);
+            break;
+        }
+    }
+}
+
+std::vector<int> RegisterCompiler::branchIfFalse(const Expr *e) {
+    std::vector<int> sites;
+    if (e->kind == Expr::Compare) {
+        // fused compare-and-branch, one link at a time so later operands stay lazy
+        auto ce = static_cast<const CompareExpr *>(e);
+        if (ce->ops.size == 1 && (ce->ops[0] == CmpOp::Eq || ce->ops[0] == CmpOp::Ne) &&
+            ce->operands[0]->kind == Expr::Binary) {
+            auto mod = static_cast<const BinaryExpr *>(ce->operands[0]);
+            const ConstExpr *divisor, *rest;
+            if (mod->op == BinOp::Mod && (divisor = literal(mod->rhs)) && (rest = literal(ce->operands[1]))) {
+                // `x % k == m`: both constants go in adjacent pool slots
+                int l = expr(mod->lhs);
+                int k = constant(divisor->value);
+                constant(rest->value);
+                sites.push_back(emit(ce->ops[0] == CmpOp::Eq ? Op::MODK_EQ_JMP : Op::MODK_NE_JMP, l, k));
+                return sites;
+            }
+        }
+        int l = expr(ce->operands[0]);
+        for (uint32_t i = 0; i < ce->ops.size; ++i) {
+            l = pin(l, ce->operands[i + 1]);
+            auto k = i + 1 == ce->ops.size ? literal(ce->operands[i + 1]) : nullptr;
+            bool proven = provenInt(ce->operands[i]) && provenInt(ce->operands[i + 1]);
+            if (k) {
+                Op op = compareConstantOp(ce->ops[i]);
+                sites.push_back(emit(proven ? provenOp(op) : op, l, constant(k->value)));
+                break;
+            }
+            int r = expr(ce->operands[i + 1]);
+            Op op = compareOp(ce->ops[i], true);
+            sites.push_back(emit(proven ? provenOp(op) : op, l, r));
+            l = r;
+        }
+        return sites;
+    }
+    if (e->kind == Expr::And) {
+        for (auto o : static_cast<const LogicExpr *>(e)->operands) {
+            auto more = branchIfFalse(o);
+            sites.insert(sites.end(), more.begin(), more.end());
+        }
+        return sites;
+    }
+    int r = expr(e);
+    sites.push_back(emit(Op::JMP_IF_FALSE, r));
+    return sites;
+}
+
+int RegisterCompiler::expr(const Expr *e, int dst) {
+    switch (e->kind) {
+        case Expr::Const: {
+            int d = dst >= 0 ? dst : newTemp();
+            emit(Op::LOADK, d, constant(static_cast<const ConstExpr *>(e)->value));
+            return d;
+        }
+        case Expr::Name: {
+            auto id = static_cast<const NameExpr *>(e)->id;
+            if (inFunction && local(id) < 0) {
+                int d = dst >= 0 ? dst : newTemp();
+                emit(Op::GETGLOBAL, d, var(id));
+                return d;
+            }
+            int r = inFunction ? local(id) : var(id);
+            if (dst < 0 || dst == r) return r;
+            emit(Op::MOVE, dst, r);
+            return dst;
+        }
+        case Expr::Neg:
+        case Expr::Not: {
+            int mark = temp;
+            int o = expr(static_cast<const UnaryExpr *>(e)->operand);
+            temp = mark;
+            int d = dst >= 0 ? dst : newTemp();
+            emit(e->kind == Expr::Neg ? Op::NEG : Op::NOT, d, o);
+            return d;
+        }
+        case Expr::Binary: {
+            auto be = static_cast<const BinaryExpr *>(e);
+            int mark = temp;
+            int l = pin(expr(be->lhs), be->rhs);
+            bool proven = provenInt(be);
+            if (auto k = literal(be->rhs)) {
+                temp = mark;
+                int d = dst >= 0 ? dst : newTemp();
+                Op op = constantOp(be->op);
+                emit(proven ? provenOp(op) : op, d, l, constant(k->value));
+                return d;
+            }
+            int r = expr(be->rhs);
+            temp = mark;
+            int d = dst >= 0 ? dst : newTemp();
+            emit(proven ? provenOp(binaryOp(be->op)) : binaryOp(be->op), d, l, r);
+            return d;
+        }
+        case Expr::Compare:
+            return compare(static_cast<const CompareExpr *>(e), dst);
+        case Expr::And:
+        case Expr::Or:
+            return logic(static_cast<const LogicExpr *>(e), dst);
+        case Expr::Call:
+            return call(static_cast<const CallExpr *>(e), dst);
+        case Expr::FString: {
+            auto fs = static_cast<const FStringExpr *>(e);
+            int base = temp;
+            for (auto &part : fs->parts) {
+                int slot = newTemp();
+                if (part.expr) expr(part.expr, slot);
+                else emit(Op::LOADK, slot, constant(Value::fromStr(std::string(part.literal))));
+            }
+            temp = base;
+            int d = dst >= 0 ? dst : newTemp();
+            emit(Op::FORMAT, d, base, int(fs->parts.size));
+            return d;
+        }
+        case Expr::Tuple:
+            // tuple values are not first-class yet; like the visitor, keep the first element
+            return expr(static_cast<const TupleExpr *>(e)->elems[0], dst);
+    }
+    return dst;
+}
+
+// Multi-instruction results are built in a temporary so that a variable used as
+// dst is not clobbered before its old value has been read.
+int RegisterCompiler::compare(const CompareExpr *e, int dst) {
+    int d = dst >= numVars ? dst : newTemp();
+    int mark = temp;
+    std::vector<int> ends;
+    int l = expr(e->operands[0]);
+    for (uint32_t i = 0; i < e->ops.size; ++i) {
+        l = pin(l, e->operands[i + 1]);
+        int r = expr(e->operands[i + 1]);
+        emit(compareOp(e->ops[i], false), d, l, r);
+        if (i + 1 < e->ops.size) ends.push_back(emit(Op::JMP_IF_FALSE, d));
+        l = r;
+    }
+    for (int at : ends) patch(at, here());
+    temp = mark;
+    if (dst >= 0 && dst != d) emit(Op::MOVE, dst, d);
+    return dst >= 0 ? dst : d;
+}
+
+int RegisterCompiler::logic(const LogicExpr *e, int dst) {
+    int d = dst >= numVars ? dst : newTemp();
+    int mark = temp;
+    Op jump = e->kind == Expr::And ? Op::JMP_IF_FALSE : Op::JMP_IF_TRUE;
+    std::vector<int> ends;
+    for (uint32_t i = 0; i < e->operands.size; ++i) {
+        expr(e->operands[i], d);
+        temp = mark;
+        if (i + 1 < e->operands.size) ends.push_back(emit(jump, d));
+    }
+    for (int at : ends) patch(at, here());
+    if (dst >= 0 && dst != d) emit(Op::MOVE, dst, d);
+    return dst >= 0 ? dst : d;
+}
+
+int RegisterCompiler::call(const CallExpr *e, int dst, bool tail) {
+    int base = temp;
+    for (auto &arg : e->args) expr(arg.value, newTemp());
+    temp = base;
+    int d = dst >= 0 ? dst : newTemp();
+    Builtin fn = builtinByName(e->callee);
+    if (fn != Builtin::None) {
+        emit(Op::CALL_BUILTIN, d, base, int(e->args.size), int(fn));
+        return d;
+    }
+    // the callee's window starts at the arguments, so they need no copying
+    rb::CallSite site;
+    site.global = var(e->callee);
+    for (auto &arg : e->args) site.keywords.emplace_back(arg.keyword);
+    chunk.sites.push_back(std::move(site));
+    emit(tail ? Op::TAIL_CALL : Op::CALL, d, base, int(chunk.sites.size()) - 1);
+    return d;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_REGISTERCOMPILER_H
+#define PYTHON_INTERPRETER_REGISTERCOMPILER_H
+
+#include <bits/stdc++.h>
+#include "Ast.h"
+#include "RangeAnalysis.h"
+#include "RegisterBytecode.h"
+#include "Scope.h"
+
+// Compiles an ast::Program into three-address code for the register VM.
+// Every variable gets a fixed register; temporaries are allocated above them
+// in stack order and released at the end of each statement. Function bodies
+// get their own register numbering, with their locals first.
+class RegisterCompiler {
+public:
+    // `return f(...)` in a def reuses the caller's window (--no-tail-calls clears it)
+    bool tailCalls = true;
+    // memoize calls to the defs ast::pureFunctions proves pure (--memoize)
+    bool memoize = false;
+    // fuse constant operands into ADDK, LT_JMPK, MODK_EQ_JMP and friends
+    // (--no-superinstructions clears it)
+    bool superinstructions = true;
+    // when set, arithmetic and compares over proven small ints use the
+    // unchecked *_INT forms
+    const RangeAnalysis *ranges = nullptr;
+
+    rb::Chunk compile(const ast::Program &program);
+
+private:
+    struct Loop {
+        int start;
+        std::vector<int> breaks;
+    };
+
+    rb::Chunk chunk;
+    std::unordered_map<std::string_view, int> vars;   // module variables (the globals)
+    std::unordered_map<std::string_view, int> locals; // of the def being compiled
+    bool inFunction = false;
+    const ast::FuncDefStmt *scope = nullptr; // def being compiled, for ranges
+    ast::NameSet moduleNames;
+    ast::NameSet memoized; // pure defs, when memoizing
+    // defs whose bodies are still to be compiled, with their function index
+    std::vector<std::pair<const ast::FuncDefStmt *, int>> pending;
+    std::vector<Loop> loops;
+    int numVars = 0, temp = 0, peak = 0; // of the code being compiled
+
+    int emit(rb::Op op, int a = 0, int b = 0, int c = 0, int aux = 0);
+    int here() const { return int(chunk.code.size()); }
+    void patch(int at, int target) { chunk.code[at].c = target; }
+    int newTemp();
+    int var(std::string_view id);
+    // register of a local in function code, else -1
+    int local(std::string_view id) const;
+    int constant(const Value &v);
+    // e when it is a constant a superinstruction can take, else null
+    const ast::ConstExpr *literal(const ast::Expr *e) const;
+    // whether RangeAnalysis proved e a small int
+    bool provenInt(const ast::Expr *e) const;
+    // r[dst] = r[l] op rhs, with rhs folded into the instruction when it is a
+    // literal; proven: operands and result are small ints
+    void binary(ast::BinOp op, int dst, int l, const ast::Expr *rhs, bool proven = false);
+    void collectNames(const ast::Block &body, const ast::NameSet *skip);
+    void collectNames(const ast::Expr *e, const ast::NameSet *skip);
+    void functionBody(const ast::FuncDefStmt *fd, int index);
+    // Register to compute a value for id into, and the store that completes it.
+    int target(std::string_view id);
+    void assignTo(std::string_view id, int reg);
+    // Copies a module variable register that a later user call could rebind.
+    int pin(int reg, const ast::Expr *later);
+
+    void block(const ast::Block &body);
+    void stmt(const ast::Stmt *s);
+    // Evaluates e and returns the register holding the result; if dst >= 0 the
+    // result is placed in dst.
+    int expr(const ast::Expr *e, int dst = -1);
+    // Emits a branch to the returned jump sites when e is false.
+    std::vector<int> branchIfFalse(const ast::Expr *e);
+    int compare(const ast::CompareExpr *e, int dst);
+    int logic(const ast::LogicExpr *e, int dst);
+    int call(const ast::CallExpr *e, int dst, bool tail = false);
+};
+
+#endif//PYTHON_INTERPRETER_REGISTERCOMPILER_H
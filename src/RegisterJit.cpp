@@ -0,0 +1,514 @@
+#include "RegisterJit.h"
+#include "SmallInt.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define PY_JIT_X64 1
+#endif
+
+using rb::Op;
+
+namespace {
+
+// the quickened and proven forms run their generic op's template
+Op genericOp(Op op) {
+    switch (op) {
+        case Op::ADD_SMALLINT: case Op::ADD_FLOAT: case Op::CONCAT_STR: case Op::ADD_INT: return Op::ADD;
+        case Op::SUB_SMALLINT: case Op::SUB_FLOAT: case Op::SUB_INT: return Op::SUB;
+        case Op::MUL_SMALLINT: case Op::MUL_FLOAT: case Op::MUL_INT: return Op::MUL;
+        case Op::ADDK_INT: return Op::ADDK;
+        case Op::SUBK_INT: return Op::SUBK;
+        case Op::MULK_INT: return Op::MULK;
+        case Op::IDIVK_INT: return Op::IDIVK;
+        case Op::MODK_INT: return Op::MODK;
+        case Op::DIV_FLOAT: return Op::DIV;
+        case Op::IDIV_SMALLINT: return Op::IDIV;
+        case Op::MOD_SMALLINT: return Op::MOD;
+        case Op::LT_SMALLINT: return Op::LT;
+        case Op::GT_SMALLINT: return Op::GT;
+        case Op::EQ_SMALLINT: return Op::EQ;
+        case Op::GE_SMALLINT: return Op::GE;
+        case Op::LE_SMALLINT: return Op::LE;
+        case Op::NE_SMALLINT: return Op::NE;
+        case Op::LT_JMP_SMALLINT: return Op::LT_JMP;
+        case Op::GT_JMP_SMALLINT: return Op::GT_JMP;
+        case Op::EQ_JMP_SMALLINT: return Op::EQ_JMP;
+        case Op::GE_JMP_SMALLINT: return Op::GE_JMP;
+        case Op::LE_JMP_SMALLINT: return Op::LE_JMP;
+        case Op::NE_JMP_SMALLINT: return Op::NE_JMP;
+        case Op::LT_JMP_INT: return Op::LT_JMP;
+        case Op::GT_JMP_INT: return Op::GT_JMP;
+        case Op::EQ_JMP_INT: return Op::EQ_JMP;
+        case Op::GE_JMP_INT: return Op::GE_JMP;
+        case Op::LE_JMP_INT: return Op::LE_JMP;
+        case Op::NE_JMP_INT: return Op::NE_JMP;
+        case Op::LT_JMPK_INT: return Op::LT_JMPK;
+        case Op::GT_JMPK_INT: return Op::GT_JMPK;
+        case Op::EQ_JMPK_INT: return Op::EQ_JMPK;
+        case Op::GE_JMPK_INT: return Op::GE_JMPK;
+        case Op::LE_JMPK_INT: return Op::LE_JMPK;
+        case Op::NE_JMPK_INT: return Op::NE_JMPK;
+        default: return op;
+    }
+}
+
+bool modEquals(const Value &x, const Value &m, const Value &y) {
+    if (isSmall(x) && isSmall(m) && isSmall(y) && !m.i.isZero())
+        return floorMod(smallOf(x), smallOf(m)) == smallOf(y);
+    return VCompare(CmpOp::Eq, VMod(x, m), y);
+}
+
+// Runtime helper: what the interpreter does for OP. Returns 0 (or the
+// branch condition) on success and -1 when it threw.
+template <Op OP>
+int step(Value *r, const Value *k, Value *globals, const rb::Instr *in) noexcept {
+    try {
+        switch (OP) {
+            case Op::LOADK: r[in->a] = k[in->b]; break;
+            case Op::MOVE: r[in->a] = r[in->b]; break;
+            case Op::GETGLOBAL: r[in->a] = globals[in->b]; break;
+            case Op::SETGLOBAL: globals[in->a] = r[in->b]; break;
+            case Op::ADD: arith<BinOp::Add>(r[in->a], r[in->b], r[in->c]); break;
+            case Op::SUB: arith<BinOp::Sub>(r[in->a], r[in->b], r[in->c]); break;
+            case Op::MUL: arith<BinOp::Mul>(r[in->a], r[in->b], r[in->c]); break;
+            case Op::DIV: arith<BinOp::Div>(r[in->a], r[in->b], r[in->c]); break;
+            case Op::IDIV: arith<BinOp::IDiv>(r[in->a], r[in->b], r[in->c]); break;
+            case Op::MOD: arith<BinOp::Mod>(r[in->a], r[in->b], r[in->c]); break;
+            case Op::ADDK: arith<BinOp::Add>(r[in->a], r[in->b], k[in->c]); break;
+            case Op::SUBK: arith<BinOp::Sub>(r[in->a], r[in->b], k[in->c]); break;
+            case Op::MULK: arith<BinOp::Mul>(r[in->a], r[in->b], k[in->c]); break;
+            case Op::DIVK: arith<BinOp::Div>(r[in->a], r[in->b], k[in->c]); break;
+            case Op::IDIVK: arith<BinOp::IDiv>(r[in->a], r[in->b], k[in->c]); break;
+            case Op::MODK: arith<BinOp::Mod>(r[in->a], r[in->b], k[in->c]); break;
+            case Op::NEG: r[in->a] = VNeg(r[in->b]); break;
+            case Op::NOT: setBool(r[in->a], !r[in->b].truthy()); break;
+            case Op::LT: setBool(r[in->a], compare<CmpOp::Lt>(r[in->b], r[in->c])); break;
+            case Op::GT: setBool(r[in->a], compare<CmpOp::Gt>(r[in->b], r[in->c])); break;
+            case Op::EQ: setBool(r[in->a], compare<CmpOp::Eq>(r[in->b], r[in->c])); break;
+            case Op::GE: setBool(r[in->a], compare<CmpOp::Ge>(r[in->b], r[in->c])); break;
+            case Op::LE: setBool(r[in->a], compare<CmpOp::Le>(r[in->b], r[in->c])); break;
+            case Op::NE: setBool(r[in->a], compare<CmpOp::Ne>(r[in->b], r[in->c])); break;
+            case Op::LT_JMP: return compare<CmpOp::Lt>(r[in->a], r[in->b]);
+            case Op::GT_JMP: return compare<CmpOp::Gt>(r[in->a], r[in->b]);
+            case Op::EQ_JMP: return compare<CmpOp::Eq>(r[in->a], r[in->b]);
+            case Op::GE_JMP: return compare<CmpOp::Ge>(r[in->a], r[in->b]);
+            case Op::LE_JMP: return compare<CmpOp::Le>(r[in->a], r[in->b]);
+            case Op::NE_JMP: return compare<CmpOp::Ne>(r[in->a], r[in->b]);
+            case Op::LT_JMPK: return compare<CmpOp::Lt>(r[in->a], k[in->b]);
+            case Op::GT_JMPK: return compare<CmpOp::Gt>(r[in->a], k[in->b]);
+            case Op::EQ_JMPK: return compare<CmpOp::Eq>(r[in->a], k[in->b]);
+            case Op::GE_JMPK: return compare<CmpOp::Ge>(r[in->a], k[in->b]);
+            case Op::LE_JMPK: return compare<CmpOp::Le>(r[in->a], k[in->b]);
+            case Op::NE_JMPK: return compare<CmpOp::Ne>(r[in->a], k[in->b]);
+            case Op::MODK_EQ_JMP: return modEquals(r[in->a], k[in->b], k[in->b + 1]);
+            case Op::MODK_NE_JMP: return !modEquals(r[in->a], k[in->b], k[in->b + 1]);
+            case Op::JMP_IF_FALSE: case Op::JMP_IF_TRUE: return r[in->a].truthy();
+            case Op::CALL_BUILTIN: r[in->a] = VCallBuiltin(Builtin(in->aux), r + in->b, in->c); break;
+            case Op::FORMAT: {
+                std::string out;
+                for (int i = 0; i < in->c; ++i) r[in->b + i].appendTo(out);
+                r[in->a] = Value::fromStr(out);
+                break;
+            }
+            default: return -1;
+        }
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+using Helper = int (*)(Value *, const Value *, Value *, const rb::Instr *);
+
+Helper helperFor(Op op) {
+    switch (op) {
+#define RB_HELPER(name) case Op::name: return &step<Op::name>;
+        RB_OPCODES(RB_HELPER)
+#undef RB_HELPER
+    }
+    return nullptr;
+}
+
+// Offsets the templates use to reach into a Value: its type, the sign and
+// limb vector (begin and end pointers, as libstdc++ stores them) of its int,
+// and its bool.
+struct Layout {
+    int32_t type, neg, begin, end, boolean;
+    bool ok;
+};
+
+const Layout &layout() {
+    static const Layout l = [] {
+        Value v = Value::fromInt(BigInt(5));
+        auto at = [&](const void *field) {
+            return int32_t(static_cast<const char *>(field) - reinterpret_cast<const char *>(&v));
+        };
+        Layout l;
+        l.type = at(&v.type);
+        l.neg = at(&v.i.neg);
+        l.begin = at(&v.i.d);
+        l.end = l.begin + int32_t(sizeof(void *));
+        l.boolean = at(&v.b);
+        auto words = reinterpret_cast<int *const *>(&v.i.d);
+        l.ok = sizeof(v.type) == 4 && sizeof(v.i.neg) == 1 && sizeof(v.b) == 1 &&
+               words[0] == v.i.d.data() && words[1] == v.i.d.data() + v.i.d.size();
+        return l;
+    }();
+    return l;
+}
+
+#ifdef PY_JIT_X64
+
+enum Reg { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSI = 6, RDI = 7, R12 = 12, R13 = 13 };
+// condition codes of jcc
+enum Cond : uint8_t { E = 0x4, NE = 0x5, S = 0x8, NS = 0x9, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF };
+constexpr int32_t kSmallMax = BigInt::BASE - 1;
+
+// Just enough of an x86-64 encoder for the templates. Memory operands are
+// always [base + disp32]; jumps are rel32 and returned for patching.
+struct Assembler {
+    std::vector<uint8_t> buf;
+
+    size_t here() const { return buf.size(); }
+    void byte(uint8_t b) { buf.push_back(b); }
+    void u32(uint32_t v) { for (int i = 0; i < 4; ++i) byte(uint8_t(v >> (8 * i))); }
+    void u64(uint64_t v) { for (int i = 0; i < 8; ++i) byte(uint8_t(v >> (8 * i))); }
+    void rex(bool w, int reg, int base) {
+        uint8_t r = 0x40 | (w << 3) | ((reg >> 3) << 2) | (base >> 3);
+        if (r != 0x40) byte(r);
+    }
+    void mem(int reg, int base, int32_t disp) {
+        byte(0x80 | (reg & 7) << 3 | (base & 7));
+        if ((base & 7) == 4) byte(0x24); // SIB for rsp / r12
+        u32(uint32_t(disp));
+    }
+    void direct(int reg, int rm) { byte(0xC0 | (reg & 7) << 3 | (rm & 7)); }
+
+    void load64(int dst, int base, int32_t disp) { rex(true, dst, base); byte(0x8B); mem(dst, base, disp); }
+    void load32(int dst, int base, int32_t disp) { rex(false, dst, base); byte(0x8B); mem(dst, base, disp); }
+    void store32(int base, int32_t disp, int src) { rex(false, src, base); byte(0x89); mem(src, base, disp); }
+    // src must be al, cl, dl or bl
+    void store8(int base, int32_t disp, int src) { rex(false, src, base); byte(0x88); mem(src, base, disp); }
+    void storeImm32(int base, int32_t disp, int32_t imm) { rex(false, 0, base); byte(0xC7); mem(0, base, disp); u32(uint32_t(imm)); }
+    void cmpMem32(int base, int32_t disp, int8_t imm) { rex(false, 0, base); byte(0x83); mem(7, base, disp); byte(uint8_t(imm)); }
+    void cmpMem8(int base, int32_t disp, int8_t imm) { rex(false, 0, base); byte(0x80); mem(7, base, disp); byte(uint8_t(imm)); }
+    // op r/m64, r64: 0x01 add, 0x29 sub, 0x31 xor, 0x39 cmp, 0x85 test, 0x89 mov
+    void alu(uint8_t opcode, int dst, int src) { rex(true, src, dst); byte(opcode); direct(src, dst); }
+    void cmpImm(int reg, int32_t imm) { rex(true, 0, reg); byte(0x81); direct(7, reg); u32(uint32_t(imm)); }
+    void addImm8(int reg, int8_t imm) { rex(true, 0, reg); byte(0x83); direct(0, reg); byte(uint8_t(imm)); }
+    void imul(int dst, int src) { rex(true, dst, src); byte(0x0F); byte(0xAF); direct(dst, src); }
+    void cqo() { byte(0x48); byte(0x99); }
+    void idiv(int reg) { rex(true, 0, reg); byte(0xF7); direct(7, reg); }
+    void neg(int reg) { rex(true, 0, reg); byte(0xF7); direct(3, reg); }
+    void sar(int reg, uint8_t n) { rex(true, 0, reg); byte(0xC1); direct(7, reg); byte(n); }
+    void andImm32(int reg, int8_t imm) { rex(false, 0, reg); byte(0x83); direct(4, reg); byte(uint8_t(imm)); }
+    void movImm64(int reg, uint64_t v) { rex(true, 0, reg); byte(0xB8 + (reg & 7)); u64(v); }
+    void movImm32(int reg, uint32_t v) { rex(false, 0, reg); byte(0xB8 + (reg & 7)); u32(v); }
+    void testEax() { byte(0x85); byte(0xC0); }
+    void callRax() { byte(0xFF); byte(0xD0); }
+    void push(int reg) { rex(false, 0, reg); byte(0x50 + (reg & 7)); }
+    void pop(int reg) { rex(false, 0, reg); byte(0x58 + (reg & 7)); }
+    void ret() { byte(0xC3); }
+    size_t jcc(Cond cc) { byte(0x0F); byte(0x80 | cc); u32(0); return here() - 4; }
+    size_t jmp() { byte(0xE9); u32(0); return here() - 4; }
+    void patch(size_t at, size_t target) {
+        int32_t rel = int32_t(target) - int32_t(at + 4);
+        std::memcpy(&buf[at], &rel, 4);
+    }
+};
+
+// condition under which `if !(x cmp y) goto c` jumps
+Cond unless(Op op) {
+    switch (op) {
+        case Op::LT_JMP: case Op::LT_JMPK: return GE;
+        case Op::GT_JMP: case Op::GT_JMPK: return LE;
+        case Op::EQ_JMP: case Op::EQ_JMPK: return NE;
+        case Op::GE_JMP: case Op::GE_JMPK: return L;
+        case Op::LE_JMP: case Op::LE_JMPK: return G;
+        default: return E;
+    }
+}
+
+// Translates one unit. Registers: rbx = r, r12 = k, r13 = globals.
+class Translator {
+public:
+    Translator(const std::vector<rb::Instr> &text, int start, int end)
+        : text(text), start(start), end(end), labels(end - start) {}
+
+    // Machine code for the unit; offsets[i] is where the code entered at
+    // points[i] starts.
+    std::vector<uint8_t> run(const std::vector<int> &points, std::vector<size_t> &offsets) {
+        for (int pc = start; pc < end; ++pc) {
+            labels[pc - start] = a.here();
+            instr(pc);
+        }
+        exitTo(a.jmp(), end);
+        // one stub per resume pc: eax = pc, then the shared epilogue
+        std::map<int, size_t> stubs;
+        std::vector<size_t> toEpilogue;
+        for (auto [at, pc] : exits) {
+            auto [it, fresh] = stubs.emplace(pc, a.here());
+            if (fresh) {
+                a.movImm32(RAX, uint32_t(pc));
+                toEpilogue.push_back(a.jmp());
+            }
+            a.patch(at, it->second);
+        }
+        for (size_t at : toEpilogue) a.patch(at, a.here());
+        a.pop(R13); a.pop(R12); a.pop(RBX);
+        a.ret();
+        // entry points: the prologue, then a jump into the body
+        for (int pc : points) {
+            offsets.push_back(a.here());
+            a.push(RBX); a.push(R12); a.push(R13);
+            a.alu(0x89, RBX, RDI); a.alu(0x89, R12, RSI); a.alu(0x89, R13, RDX);
+            jumps.emplace_back(a.jmp(), pc);
+        }
+        for (auto [at, pc] : jumps) a.patch(at, labels[pc - start]);
+        return std::move(a.buf);
+    }
+
+private:
+    const std::vector<rb::Instr> &text;
+    int start, end;
+    Assembler a;
+    std::vector<size_t> labels;                  // by pc - start
+    std::vector<std::pair<size_t, int>> jumps;   // rel32 to patch, target pc in the unit
+    std::vector<std::pair<size_t, int>> exits;   // rel32 to patch, pc to resume at
+    std::vector<size_t> slow;                    // guards of the current template
+
+    static int32_t slot(int index) { return int32_t(index * sizeof(Value)); }
+
+    void exitTo(size_t at, int pc) { exits.emplace_back(at, pc); }
+    void jumpTo(size_t at, int pc) {
+        if (pc >= start && pc < end) jumps.emplace_back(at, pc);
+        else exitTo(at, pc);
+    }
+
+    // dst = the small int at [base + disp], else to the slow path; clobbers rdx
+    void smallInt(int dst, int base, int32_t disp) {
+        const Layout &l = layout();
+        a.cmpMem32(base, disp + l.type, Value::T_INT);
+        slow.push_back(a.jcc(NE));
+        a.load64(RDX, base, disp + l.end);
+        a.load64(dst, base, disp + l.begin);
+        a.alu(0x29, RDX, dst);
+        a.cmpImm(RDX, sizeof(int));
+        slow.push_back(a.jcc(NE));
+        a.load32(dst, dst, 0);
+        a.cmpMem8(base, disp + l.neg, 0);
+        a.byte(0x74); a.byte(3); // je over the 3-byte neg
+        a.neg(dst);
+    }
+
+    // Stores rax as a small int into the register at disp, else to the slow
+    // path; the destination must already own a one-limb buffer.
+    void storeSmall(int32_t disp) {
+        const Layout &l = layout();
+        a.alu(0x89, RCX, RAX);
+        a.sar(RCX, 63);
+        a.alu(0x31, RAX, RCX);
+        a.alu(0x29, RAX, RCX); // rax = |result|, rcx = sign mask
+        a.cmpImm(RAX, kSmallMax);
+        slow.push_back(a.jcc(G));
+        a.load64(RDX, RBX, disp + l.end);
+        a.load64(RSI, RBX, disp + l.begin);
+        a.alu(0x29, RDX, RSI);
+        a.cmpImm(RDX, sizeof(int));
+        slow.push_back(a.jcc(NE));
+        a.storeImm32(RBX, disp + l.type, Value::T_INT);
+        a.andImm32(RCX, 1);
+        a.store8(RBX, disp + l.neg, RCX);
+        a.store32(RSI, 0, RAX);
+    }
+
+    // rax = floor(rax / rcx) or floor(rax mod rcx), Python style; a zero
+    // divisor takes the slow path. Clobbers rdx and rsi.
+    void divide(bool mod) {
+        a.alu(0x85, RCX, RCX);
+        slow.push_back(a.jcc(E));
+        a.cqo();
+        a.idiv(RCX);
+        a.alu(0x85, RDX, RDX);
+        size_t exact = a.jcc(E);
+        a.alu(0x89, RSI, RDX);
+        a.alu(0x31, RSI, RCX);
+        size_t sameSign = a.jcc(NS);
+        if (mod) a.alu(0x01, RDX, RCX);
+        else a.addImm8(RAX, -1);
+        a.patch(exact, a.here());
+        a.patch(sameSign, a.here());
+        if (mod) a.alu(0x89, RAX, RDX);
+    }
+
+    // Calls the helper of the instruction at pc; a failure resumes there.
+    void call(int pc) {
+        a.alu(0x89, RDI, RBX); a.alu(0x89, RSI, R12); a.alu(0x89, RDX, R13);
+        a.movImm64(RCX, reinterpret_cast<uint64_t>(&text[pc]));
+        a.movImm64(RAX, reinterpret_cast<uint64_t>(helperFor(genericOp(text[pc].op))));
+        a.callRax();
+        a.testEax();
+        exitTo(a.jcc(S), pc);
+    }
+
+    // Ends the fast path of a template and starts its slow path; returns
+    // the jump over the slow path.
+    size_t slowPath() {
+        size_t done = a.jmp();
+        for (size_t at : slow) a.patch(at, a.here());
+        slow.clear();
+        return done;
+    }
+
+    void instr(int pc) {
+        const rb::Instr &in = text[pc];
+        Op op = genericOp(in.op);
+        switch (op) {
+            case Op::JMP:
+                jumpTo(a.jmp(), in.c);
+                return;
+            case Op::ADD: case Op::SUB: case Op::MUL: case Op::IDIV: case Op::MOD:
+            case Op::ADDK: case Op::SUBK: case Op::MULK: case Op::IDIVK: case Op::MODK: {
+                bool constant = op >= Op::ADDK && op <= Op::MODK;
+                smallInt(RAX, RBX, slot(in.b));
+                smallInt(RCX, constant ? R12 : RBX, slot(in.c));
+                switch (op) {
+                    case Op::ADD: case Op::ADDK: a.alu(0x01, RAX, RCX); break;
+                    case Op::SUB: case Op::SUBK: a.alu(0x29, RAX, RCX); break;
+                    case Op::MUL: case Op::MULK: a.imul(RAX, RCX); break;
+                    case Op::IDIV: case Op::IDIVK: divide(false); break;
+                    default: divide(true); break;
+                }
+                storeSmall(slot(in.a));
+                size_t done = slowPath();
+                call(pc);
+                a.patch(done, a.here());
+                return;
+            }
+            case Op::LT_JMP: case Op::GT_JMP: case Op::EQ_JMP:
+            case Op::GE_JMP: case Op::LE_JMP: case Op::NE_JMP:
+            case Op::LT_JMPK: case Op::GT_JMPK: case Op::EQ_JMPK:
+            case Op::GE_JMPK: case Op::LE_JMPK: case Op::NE_JMPK: {
+                bool constant = op >= Op::LT_JMPK && op <= Op::NE_JMPK;
+                smallInt(RAX, RBX, slot(in.a));
+                smallInt(RCX, constant ? R12 : RBX, slot(in.b));
+                a.alu(0x39, RAX, RCX);
+                jumpTo(a.jcc(unless(op)), in.c);
+                size_t done = slowPath();
+                call(pc);
+                jumpTo(a.jcc(E), in.c); // the helper returned false
+                a.patch(done, a.here());
+                return;
+            }
+            case Op::JMP_IF_FALSE: case Op::JMP_IF_TRUE: {
+                Cond taken = op == Op::JMP_IF_FALSE ? E : NE;
+                a.cmpMem32(RBX, slot(in.a) + layout().type, Value::T_BOOL);
+                slow.push_back(a.jcc(NE));
+                a.cmpMem8(RBX, slot(in.a) + layout().boolean, 0);
+                jumpTo(a.jcc(taken), in.c);
+                size_t done = slowPath();
+                call(pc);
+                jumpTo(a.jcc(taken), in.c);
+                a.patch(done, a.here());
+                return;
+            }
+            case Op::MODK_EQ_JMP: case Op::MODK_NE_JMP: {
+                smallInt(RAX, RBX, slot(in.a));
+                smallInt(RCX, R12, slot(in.b));
+                divide(true);
+                smallInt(RCX, R12, slot(in.b + 1));
+                a.alu(0x39, RAX, RCX);
+                jumpTo(a.jcc(op == Op::MODK_EQ_JMP ? NE : E), in.c);
+                size_t done = slowPath();
+                call(pc);
+                jumpTo(a.jcc(E), in.c);
+                a.patch(done, a.here());
+                return;
+            }
+            case Op::CALL: case Op::TAIL_CALL: case Op::RET:
+            case Op::MAKE_FUNCTION: case Op::HALT:
+                exitTo(a.jmp(), pc);
+                return;
+            default:
+                call(pc);
+                return;
+        }
+    }
+};
+
+#endif // PY_JIT_X64
+
+} // namespace
+
+bool RegisterJit::available() {
+#ifdef PY_JIT_X64
+    return layout().ok;
+#else
+    return false;
+#endif
+}
+
+RegisterJit::RegisterJit(const std::vector<rb::Instr> &text, const rb::Chunk &chunk, Value *globals)
+    : text(text), chunk(chunk), consts(chunk.consts.data()), globals(globals), points(text.size()) {
+    bounds.push_back(0);
+    for (auto &fn : chunk.functions) bounds.push_back(fn.entry);
+    bounds.push_back(int(text.size()));
+    std::sort(bounds.begin(), bounds.end());
+}
+
+RegisterJit::~RegisterJit() {
+#ifdef PY_JIT_X64
+    for (auto [addr, size] : mappings) munmap(addr, size);
+#endif
+}
+
+bool RegisterJit::compile(int pc) {
+#ifdef PY_JIT_X64
+    auto next = std::upper_bound(bounds.begin(), bounds.end(), pc);
+    int start = next[-1], end = *next;
+    // a function's entry and every loop head, i.e. target of a backward JMP
+    std::vector<int> heads;
+    if (start != 0) heads.push_back(start);
+    for (int i = start; i < end; ++i)
+        if (text[i].op == Op::JMP && text[i].c >= start && text[i].c <= i) heads.push_back(text[i].c);
+    std::sort(heads.begin(), heads.end());
+    heads.erase(std::unique(heads.begin(), heads.end()), heads.end());
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> code = Translator(text, start, end).run(heads, offsets);
+    // written while writable, then made executable and read-only
+    size_t size = code.size();
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) return false;
+    std::memcpy(addr, code.data(), size);
+    if (mprotect(addr, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(addr, size);
+        return false;
+    }
+    mappings.emplace_back(addr, size);
+    for (size_t i = 0; i < heads.size(); ++i)
+        points[heads[i]].code = reinterpret_cast<Entry>(static_cast<uint8_t *>(addr) + offsets[i]);
+    ++compiled;
+    bytes += size;
+    return points[pc].code != nullptr;
+#else
+    (void)pc;
+    return false;
+#endif
+}
+
+void RegisterJit::report(std::ostream &os) const {
+    for (int pc = 0; pc < int(points.size()); ++pc) {
+        const Point &p = points[pc];
+        if (!p.code) continue;
+        const rb::Function *fn = nullptr;
+        int start = std::upper_bound(bounds.begin(), bounds.end(), pc)[-1];
+        for (auto &f : chunk.functions)
+            if (f.entry == start) fn = &f;
+        std::string unit = fn ? fn->name : "<module>";
+        bool call = fn && pc == start;
+        os << "tier: " << (call ? "function " + unit : "loop at pc " + std::to_string(pc) + " in " + unit);
+        if (p.tripped) os << " promoted after " << p.heat << (call ? " calls" : " back edges");
+        else os << " compiled with its unit";
+        os << ", " << p.entries << " native entries\n";
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_REGISTERJIT_H
+#define PYTHON_INTERPRETER_REGISTERJIT_H
+
+#include <bits/stdc++.h>
+#include "RegisterBytecode.h"
+
+// Optional native tier of RegisterVM (--jit, Linux x86-64 only).
+//
+// Execution is tiered: code starts in the interpreter, which counts the
+// calls of each function and the back edges of each loop. When a counter
+// reaches hotThreshold, the unit holding it (the module code or the whole
+// function body) is translated instruction by instruction from machine-code
+// templates into mmap'd executable memory, with one entry point at the
+// function entry and one at every loop head. A loop that trips its counter
+// moves into native code on that same back edge (on-stack replacement): the
+// interpreter's register window is the live state, so the entry point takes
+// it as is.
+//  - + - * // % (register or constant operand), compare-and-branch and
+//    MODK_EQ_JMP / MODK_NE_JMP test their operands for small ints and compute
+//    inline, writing a result into the destination's limb buffer;
+//  - every other op that cannot leave the window calls a runtime helper with
+//    the op's generic semantics (BigInt, float, str, builtins);
+//  - calls, returns, MAKE_FUNCTION and HALT, and helpers that throw end the
+//    native code, which returns the pc the interpreter resumes at. An
+//    instruction that threw is re-run there, so the error surfaces as usual.
+class RegisterJit {
+public:
+    using Entry = int32_t (*)(Value *r, const Value *k, Value *globals);
+    uint32_t hotThreshold = 64; // --jit-threshold
+    size_t compiled = 0, bytes = 0; // units, machine code
+    uint64_t entries = 0;
+
+    // false off Linux x86-64 or when Value is not laid out as the templates expect
+    static bool available();
+
+    RegisterJit(const std::vector<rb::Instr> &text, const rb::Chunk &chunk, Value *globals);
+    ~RegisterJit();
+    RegisterJit(const RegisterJit &) = delete;
+    RegisterJit &operator=(const RegisterJit &) = delete;
+
+    // Counts a call (pc = function entry) or back edge (pc = loop head) and,
+    // once pc's unit is native, runs it from pc over the window r. Returns
+    // the pc to go on interpreting at: pc itself while the unit is cold.
+    int enter(int pc, Value *r) {
+        Point &point = points[pc];
+        if (!point.code) {
+            if (++point.heat != hotThreshold || !compile(pc)) return pc;
+            point.tripped = true;
+        }
+        ++point.entries;
+        ++entries;
+        return point.code(r, consts, globals);
+    }
+
+    // One line per entry point of the compiled units (--tier-stats).
+    void report(std::ostream &os) const;
+
+private:
+    // a function entry or loop head
+    struct Point {
+        Entry code = nullptr;
+        uint32_t heat = 0;    // calls or back edges counted while interpreted
+        bool tripped = false; // its own counter got the unit compiled
+        uint64_t entries = 0; // into native code
+    };
+
+    const std::vector<rb::Instr> &text;
+    const rb::Chunk &chunk;
+    const Value *consts;
+    Value *globals;
+    std::vector<int> bounds;   // unit starts: 0, the function entries, then text.size()
+    std::vector<Point> points; // by pc
+    std::vector<std::pair<void *, size_t>> mappings;
+
+    // Compiles the unit holding pc; false if it could not be mapped.
+    bool compile(int pc);
+};
+
+#endif//PYTHON_INTERPRETER_REGISTERJIT_H
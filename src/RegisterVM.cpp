@@ -0,0 +1,577 @@
+#include "RegisterVM.h"
+#include "Dispatch.h"
+#include "SmallInt.h"
+
+using rb::Op;
+
+namespace {
+
+// operand kinds a site can quicken on; Mixed sites stay generic
+enum Kind : uint8_t { None, SmallInt, Float, Str, Mixed };
+
+Kind kindOf(const Value &x, const Value &y) {
+    if (isSmall(x) && isSmall(y)) return SmallInt;
+    if (x.type != y.type) return Mixed;
+    if (x.type == Value::T_FLOAT) return Float;
+    if (x.type == Value::T_STR) return Str;
+    return Mixed;
+}
+
+// the specialized form of generic op for kind, or op itself if there is none
+Op specialize(Op op, Kind kind) {
+    if (kind == SmallInt) {
+        switch (op) {
+            case Op::ADD: return Op::ADD_SMALLINT;
+            case Op::SUB: return Op::SUB_SMALLINT;
+            case Op::MUL: return Op::MUL_SMALLINT;
+            case Op::IDIV: return Op::IDIV_SMALLINT;
+            case Op::MOD: return Op::MOD_SMALLINT;
+            case Op::LT: return Op::LT_SMALLINT;
+            case Op::GT: return Op::GT_SMALLINT;
+            case Op::EQ: return Op::EQ_SMALLINT;
+            case Op::GE: return Op::GE_SMALLINT;
+            case Op::LE: return Op::LE_SMALLINT;
+            case Op::NE: return Op::NE_SMALLINT;
+            case Op::LT_JMP: return Op::LT_JMP_SMALLINT;
+            case Op::GT_JMP: return Op::GT_JMP_SMALLINT;
+            case Op::EQ_JMP: return Op::EQ_JMP_SMALLINT;
+            case Op::GE_JMP: return Op::GE_JMP_SMALLINT;
+            case Op::LE_JMP: return Op::LE_JMP_SMALLINT;
+            case Op::NE_JMP: return Op::NE_JMP_SMALLINT;
+            default: return op;
+        }
+    }
+    if (kind == Float) {
+        switch (op) {
+            case Op::ADD: return Op::ADD_FLOAT;
+            case Op::SUB: return Op::SUB_FLOAT;
+            case Op::MUL: return Op::MUL_FLOAT;
+            case Op::DIV: return Op::DIV_FLOAT;
+            default: return op;
+        }
+    }
+    if (kind == Str && op == Op::ADD) return Op::CONCAT_STR;
+    return op;
+}
+
+} // namespace
+
+void RegisterVM::run(const rb::Chunk &program) {
+    chunk = &program;
+    text = program.code;
+    feedback.assign(text.size(), Site());
+    functions.assign(program.names.size(), nullptr);
+    caches.assign(program.sites.size(), SiteCache());
+    size_t window = 0, params = 0;
+    for (auto &fn : program.functions) {
+        window = std::max(window, size_t(fn.numRegs));
+        params = std::max(params, fn.params.size());
+    }
+    // a window starts below the caller's top, so each call adds at most one callee window
+    regs.assign(program.numRegs + window * kMaxCallDepth, Value());
+    scratch.assign(params, Value());
+    calls.clear();
+    calls.reserve(kMaxCallDepth);
+    memoSlots.clear();
+    native.reset();
+    if (jit && RegisterJit::available()) {
+        native = std::make_unique<RegisterJit>(text, program, regs.data());
+        native->hotThreshold = jitThreshold;
+    }
+    execute();
+}
+
+const RegisterVM::BoundFunction &RegisterVM::enter(int site, int argc, Value *args) {
+    static const Value none;
+    const BoundFunction *callee = functions[chunk->sites[site].global];
+    if (!callee) throw std::runtime_error("'" + chunk->names[chunk->sites[site].global] + "' is not a function");
+    SiteCache &cache = caches[site];
+    if (cache.fn != callee) {
+        cache.binding = bindArguments(callee->fn->name, callee->fn->params, callee->defaults.size(), chunk->sites[site].keywords);
+        cache.fn = callee;
+    }
+    const rb::Function &fn = *callee->fn;
+    const ArgBinding &binding = cache.binding;
+    if (!binding.inOrder) {
+        for (int i = 0; i < argc; ++i) scratch[i] = std::move(args[i]);
+        for (int i = 0; i < argc; ++i) args[binding.slotOfArg[i]] = std::move(scratch[i]);
+        size_t firstDefault = fn.params.size() - callee->defaults.size();
+        for (int p : binding.fromDefault) args[p] = callee->defaults[p - firstDefault];
+    }
+    for (size_t i = fn.params.size(); i < fn.locals.size(); ++i) args[i] = none;
+    return *callee;
+}
+
+void RegisterVM::observe(rb::Instr *in, const Value &x, const Value &y) {
+    Site &site = feedback[in - text.data()];
+    if (site.kind == Mixed) return;
+    Kind kind = kindOf(x, y);
+    if (site.count && kind != site.kind) {
+        site.kind = Mixed;
+        return;
+    }
+    site.kind = kind;
+    if (++site.count < kQuickenAfter) return;
+    Op op = specialize(in->op, kind);
+    if (op == in->op) {
+        site.kind = Mixed;
+        return;
+    }
+    site.generic = in->op;
+    in->op = op;
+    ++quickened;
+}
+
+void RegisterVM::deopt(rb::Instr *in) {
+    Site &site = feedback[in - text.data()];
+    site.kind = Mixed;
+    in->op = site.generic;
+    ++deopts;
+}
+
+void RegisterVM::execute() {
+    const rb::Chunk &chunk = *this->chunk;
+    Value *globals = regs.data(), *r = globals;
+    const Value *k = chunk.consts.data();
+    rb::Instr *code = text.data();
+    rb::Instr *pc = code;
+    rb::Instr *in;
+    const bool quicken = this->quicken;
+    RegisterJit *native = this->native.get();
+    uint64_t n = 0;
+#ifdef PY_THREADED_DISPATCH
+    static void *const dispatchTable[] = { RB_OPCODES(PY_LABEL_ADDR) };
+#define DISPATCH() do { in = pc++; ++n; goto *dispatchTable[int(in->op)]; } while (0)
+    DISPATCH();
+#else
+#define DISPATCH() continue
+    for (;;) {
+        in = pc++;
+        ++n;
+        switch (in->op) {
+#endif
+    PY_TARGET(LOADK) {
+        r[in->a] = k[in->b];
+        DISPATCH();
+    }
+    PY_TARGET(MOVE) {
+        r[in->a] = r[in->b];
+        DISPATCH();
+    }
+    PY_TARGET(GETGLOBAL) {
+        r[in->a] = globals[in->b];
+        DISPATCH();
+    }
+    PY_TARGET(SETGLOBAL) {
+        globals[in->a] = r[in->b];
+        DISPATCH();
+    }
+    PY_TARGET(ADD) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = VAdd(r[in->b], r[in->c]);
+        DISPATCH();
+    }
+    PY_TARGET(SUB) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = VSub(r[in->b], r[in->c]);
+        DISPATCH();
+    }
+    PY_TARGET(MUL) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = VMul(r[in->b], r[in->c]);
+        DISPATCH();
+    }
+    PY_TARGET(DIV) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = VDivFloat(r[in->b], r[in->c]);
+        DISPATCH();
+    }
+    PY_TARGET(IDIV) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = VDivInt(r[in->b], r[in->c]);
+        DISPATCH();
+    }
+    PY_TARGET(MOD) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = VMod(r[in->b], r[in->c]);
+        DISPATCH();
+    }
+    PY_TARGET(NEG) {
+        r[in->a] = VNeg(r[in->b]);
+        DISPATCH();
+    }
+    PY_TARGET(NOT) {
+        r[in->a] = Value::fromBool(!r[in->b].truthy());
+        DISPATCH();
+    }
+    PY_TARGET(LT) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = Value::fromBool(VCompare(CmpOp::Lt, r[in->b], r[in->c]));
+        DISPATCH();
+    }
+    PY_TARGET(GT) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = Value::fromBool(VCompare(CmpOp::Gt, r[in->b], r[in->c]));
+        DISPATCH();
+    }
+    PY_TARGET(EQ) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = Value::fromBool(VCompare(CmpOp::Eq, r[in->b], r[in->c]));
+        DISPATCH();
+    }
+    PY_TARGET(GE) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = Value::fromBool(VCompare(CmpOp::Ge, r[in->b], r[in->c]));
+        DISPATCH();
+    }
+    PY_TARGET(LE) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = Value::fromBool(VCompare(CmpOp::Le, r[in->b], r[in->c]));
+        DISPATCH();
+    }
+    PY_TARGET(NE) {
+        if (quicken) observe(in, r[in->b], r[in->c]);
+        r[in->a] = Value::fromBool(VCompare(CmpOp::Ne, r[in->b], r[in->c]));
+        DISPATCH();
+    }
+    PY_TARGET(LT_JMP) {
+        if (quicken) observe(in, r[in->a], r[in->b]);
+        if (!VCompare(CmpOp::Lt, r[in->a], r[in->b])) pc = code + in->c;
+        DISPATCH();
+    }
+    PY_TARGET(GT_JMP) {
+        if (quicken) observe(in, r[in->a], r[in->b]);
+        if (!VCompare(CmpOp::Gt, r[in->a], r[in->b])) pc = code + in->c;
+        DISPATCH();
+    }
+    PY_TARGET(EQ_JMP) {
+        if (quicken) observe(in, r[in->a], r[in->b]);
+        if (!VCompare(CmpOp::Eq, r[in->a], r[in->b])) pc = code + in->c;
+        DISPATCH();
+    }
+    PY_TARGET(GE_JMP) {
+        if (quicken) observe(in, r[in->a], r[in->b]);
+        if (!VCompare(CmpOp::Ge, r[in->a], r[in->b])) pc = code + in->c;
+        DISPATCH();
+    }
+    PY_TARGET(LE_JMP) {
+        if (quicken) observe(in, r[in->a], r[in->b]);
+        if (!VCompare(CmpOp::Le, r[in->a], r[in->b])) pc = code + in->c;
+        DISPATCH();
+    }
+    PY_TARGET(NE_JMP) {
+        if (quicken) observe(in, r[in->a], r[in->b]);
+        if (!VCompare(CmpOp::Ne, r[in->a], r[in->b])) pc = code + in->c;
+        DISPATCH();
+    }
+    // Superinstructions: a constant operand from the pool, with the
+    // small-int case inline.
+#define RB_CONST_ARITH(OP, CALC, GENERIC)                                      \
+    PY_TARGET(OP##K) {                                                         \
+        const Value &x = r[in->b], &y = k[in->c];                              \
+        if (isSmall(x) && isSmall(y)) {                                        \
+            setSmall(r[in->a], smallOf(x) CALC smallOf(y));                    \
+            DISPATCH();                                                        \
+        }                                                                      \
+        if (x.type == Value::T_FLOAT && y.type == Value::T_FLOAT) {            \
+            setFloat(r[in->a], x.f CALC y.f);                                  \
+            DISPATCH();                                                        \
+        }                                                                      \
+        r[in->a] = GENERIC(x, y);                                              \
+        DISPATCH();                                                            \
+    }
+    RB_CONST_ARITH(SUB, -, VSub)
+    RB_CONST_ARITH(MUL, *, VMul)
+#undef RB_CONST_ARITH
+    PY_TARGET(ADDK) {
+        const Value &x = r[in->b], &y = k[in->c];
+        if (isSmall(x) && isSmall(y)) {
+            setSmall(r[in->a], smallOf(x) + smallOf(y));
+            DISPATCH();
+        }
+        if (x.type == Value::T_FLOAT && y.type == Value::T_FLOAT) {
+            setFloat(r[in->a], x.f + y.f);
+            DISPATCH();
+        }
+        if (in->a == in->b && x.type == Value::T_STR && y.type == Value::T_STR) {
+            r[in->a].s += y.s;  // `s += "..."` appends in place
+            DISPATCH();
+        }
+        r[in->a] = VAdd(x, y);
+        DISPATCH();
+    }
+#define RB_CONST_DIVIDE(OP, FLOOR, GENERIC)                                    \
+    PY_TARGET(OP##K) {                                                         \
+        const Value &x = r[in->b], &y = k[in->c];                              \
+        if (isSmall(x) && isSmall(y) && !y.i.isZero()) {                       \
+            setSmall(r[in->a], FLOOR(smallOf(x), smallOf(y)));                 \
+            DISPATCH();                                                        \
+        }                                                                      \
+        r[in->a] = GENERIC(x, y);                                              \
+        DISPATCH();                                                            \
+    }
+    RB_CONST_DIVIDE(IDIV, floorDiv, VDivInt)
+    RB_CONST_DIVIDE(MOD, floorMod, VMod)
+#undef RB_CONST_DIVIDE
+    PY_TARGET(DIVK) {
+        r[in->a] = VDivFloat(r[in->b], k[in->c]);
+        DISPATCH();
+    }
+#define RB_CONST_CMP_JMP(OP, CMP, CMPOP)                                       \
+    PY_TARGET(OP##_JMPK) {                                                     \
+        const Value &x = r[in->a], &y = k[in->b];                              \
+        bool holds = isSmall(x) && isSmall(y) ? smallOf(x) CMP smallOf(y)      \
+                                              : VCompare(CmpOp::CMPOP, x, y);  \
+        if (!holds) pc = code + in->c;                                         \
+        DISPATCH();                                                            \
+    }
+    RB_CONST_CMP_JMP(LT, <, Lt)
+    RB_CONST_CMP_JMP(GT, >, Gt)
+    RB_CONST_CMP_JMP(EQ, ==, Eq)
+    RB_CONST_CMP_JMP(GE, >=, Ge)
+    RB_CONST_CMP_JMP(LE, <=, Le)
+    RB_CONST_CMP_JMP(NE, !=, Ne)
+#undef RB_CONST_CMP_JMP
+    PY_TARGET(MODK_EQ_JMP)
+    PY_TARGET(MODK_NE_JMP) {
+        const Value &x = r[in->a], &m = k[in->b], &y = k[in->b + 1];
+        bool eq;
+        if (isSmall(x) && isSmall(m) && isSmall(y) && !m.i.isZero())
+            eq = floorMod(smallOf(x), smallOf(m)) == smallOf(y);
+        else
+            eq = VCompare(CmpOp::Eq, VMod(x, m), y);
+        if (eq != (in->op == Op::MODK_EQ_JMP)) pc = code + in->c;
+        DISPATCH();
+    }
+    PY_TARGET(JMP) {
+        pc = code + in->c;
+        if (native && pc <= in) pc = code + native->enter(in->c, r); // a loop's back edge
+        DISPATCH();
+    }
+    PY_TARGET(JMP_IF_FALSE) {
+        if (!r[in->a].truthy()) pc = code + in->c;
+        DISPATCH();
+    }
+    PY_TARGET(JMP_IF_TRUE) {
+        if (r[in->a].truthy()) pc = code + in->c;
+        DISPATCH();
+    }
+    PY_TARGET(CALL_BUILTIN) {
+        r[in->a] = VCallBuiltin(Builtin(in->aux), r + in->b, in->c);
+        DISPATCH();
+    }
+    PY_TARGET(FORMAT) {
+        std::string out;
+        for (int i = 0; i < in->c; ++i) r[in->b + i].appendTo(out);
+        r[in->a] = Value::fromStr(out);
+        DISPATCH();
+    }
+    PY_TARGET(MAKE_FUNCTION) {
+        const rb::Function &fn = chunk.functions[in->a];
+        MemoTable *memo = fn.pure ? &memos.emplace_back(fn.name) : nullptr;
+        BoundFunction &b = bound.emplace_back(BoundFunction{&fn, {}, memo});
+        b.defaults.assign(r + in->b, r + in->b + in->c);
+        functions[fn.global] = &b;
+        DISPATCH();
+    }
+    PY_TARGET(CALL) {
+        if (calls.size() >= size_t(kMaxCallDepth)) throw std::runtime_error("maximum recursion depth exceeded");
+        const BoundFunction &callee = enter(in->c, chunk.sites[in->c].keywords.size(), r + in->b);
+        const rb::Function &fn = *callee.fn;
+        uint32_t memoBase = memoSlots.size();
+        if (callee.memo) {
+            auto [slot, hit] = callee.memo->lookup(r + in->b, fn.params.size());
+            if (hit) {
+                r[in->a] = **slot;
+                DISPATCH();
+            }
+            if (slot) memoSlots.push_back(slot);
+        }
+        calls.push_back(CallFrame{pc, r, in->a, memoBase});
+        r += in->b;
+        pc = code + (native ? native->enter(fn.entry, r) : fn.entry);
+        DISPATCH();
+    }
+    PY_TARGET(TAIL_CALL) {
+        // the arguments replace the current window, so the call depth stays put;
+        // swapping keeps the old values' buffers for the registers above to reuse
+        int argc = chunk.sites[in->c].keywords.size();
+        if (in->b != 0)
+            for (int i = 0; i < argc; ++i) std::swap(r[i], r[in->b + i]);
+        const BoundFunction &callee = enter(in->c, argc, r);
+        const rb::Function &fn = *callee.fn;
+        if (callee.memo) {
+            auto [slot, hit] = callee.memo->lookup(r, fn.params.size());
+            if (hit) {
+                // the current window returns the cached result
+                const CallFrame &caller = calls.back();
+                settle(**slot, caller.memoBase);
+                r = caller.r;
+                r[caller.dst] = **slot;
+                pc = caller.pc;
+                calls.pop_back();
+                DISPATCH();
+            }
+            if (slot) memoSlots.push_back(slot);
+        }
+        pc = code + (native ? native->enter(fn.entry, r) : fn.entry);
+        DISPATCH();
+    }
+    PY_TARGET(RET) {
+        Value result = std::move(r[in->a]);
+        const CallFrame &caller = calls.back();
+        if (memoSlots.size() > caller.memoBase) settle(result, caller.memoBase);
+        r = caller.r;
+        r[caller.dst] = std::move(result);
+        pc = caller.pc;
+        calls.pop_back();
+        DISPATCH();
+    }
+    // Quickened forms. Each guards on its operand kind and, when the guard
+    // fails, deoptimizes and finishes the instruction generically.
+#define RB_SMALLINT_ARITH(OP, EXPR, GENERIC)                                   \
+    PY_TARGET(OP##_SMALLINT) {                                                 \
+        const Value &x = r[in->b], &y = r[in->c];                              \
+        if (isSmall(x) && isSmall(y)) {                                        \
+            long long a = smallOf(x), b = smallOf(y);                          \
+            setSmall(r[in->a], EXPR);                                          \
+            DISPATCH();                                                        \
+        }                                                                      \
+        deopt(in);                                                             \
+        r[in->a] = GENERIC(x, y);                                              \
+        DISPATCH();                                                            \
+    }
+    RB_SMALLINT_ARITH(ADD, a + b, VAdd)
+    RB_SMALLINT_ARITH(SUB, a - b, VSub)
+    RB_SMALLINT_ARITH(MUL, a * b, VMul)
+#undef RB_SMALLINT_ARITH
+    PY_TARGET(IDIV_SMALLINT) {
+        const Value &x = r[in->b], &y = r[in->c];
+        if (isSmall(x) && isSmall(y) && !y.i.isZero()) {
+            setSmall(r[in->a], floorDiv(smallOf(x), smallOf(y)));
+            DISPATCH();
+        }
+        deopt(in);
+        r[in->a] = VDivInt(x, y);
+        DISPATCH();
+    }
+    PY_TARGET(MOD_SMALLINT) {
+        const Value &x = r[in->b], &y = r[in->c];
+        if (isSmall(x) && isSmall(y) && !y.i.isZero()) {
+            setSmall(r[in->a], floorMod(smallOf(x), smallOf(y)));
+            DISPATCH();
+        }
+        deopt(in);
+        r[in->a] = VMod(x, y);
+        DISPATCH();
+    }
+#define RB_SMALLINT_CMP(OP, CMP, CMPOP)                                        \
+    PY_TARGET(OP##_SMALLINT) {                                                 \
+        const Value &x = r[in->b], &y = r[in->c];                              \
+        if (isSmall(x) && isSmall(y)) {                                        \
+            setBool(r[in->a], smallOf(x) CMP smallOf(y));                      \
+            DISPATCH();                                                        \
+        }                                                                      \
+        deopt(in);                                                             \
+        r[in->a] = Value::fromBool(VCompare(CmpOp::CMPOP, x, y));              \
+        DISPATCH();                                                            \
+    }                                                                          \
+    PY_TARGET(OP##_JMP_SMALLINT) {                                             \
+        const Value &x = r[in->a], &y = r[in->b];                              \
+        if (isSmall(x) && isSmall(y)) {                                        \
+            if (!(smallOf(x) CMP smallOf(y))) pc = code + in->c;               \
+            DISPATCH();                                                        \
+        }                                                                      \
+        deopt(in);                                                             \
+        if (!VCompare(CmpOp::CMPOP, x, y)) pc = code + in->c;                  \
+        DISPATCH();                                                            \
+    }
+    RB_SMALLINT_CMP(LT, <, Lt)
+    RB_SMALLINT_CMP(GT, >, Gt)
+    RB_SMALLINT_CMP(EQ, ==, Eq)
+    RB_SMALLINT_CMP(GE, >=, Ge)
+    RB_SMALLINT_CMP(LE, <=, Le)
+    RB_SMALLINT_CMP(NE, !=, Ne)
+#undef RB_SMALLINT_CMP
+#define RB_FLOAT_ARITH(OP, CALC, GENERIC)                                      \
+    PY_TARGET(OP##_FLOAT) {                                                    \
+        const Value &x = r[in->b], &y = r[in->c];                              \
+        if (x.type == Value::T_FLOAT && y.type == Value::T_FLOAT) {            \
+            setFloat(r[in->a], x.f CALC y.f);                                  \
+            DISPATCH();                                                        \
+        }                                                                      \
+        deopt(in);                                                             \
+        r[in->a] = GENERIC(x, y);                                              \
+        DISPATCH();                                                            \
+    }
+    RB_FLOAT_ARITH(ADD, +, VAdd)
+    RB_FLOAT_ARITH(SUB, -, VSub)
+    RB_FLOAT_ARITH(MUL, *, VMul)
+    RB_FLOAT_ARITH(DIV, /, VDivFloat)
+#undef RB_FLOAT_ARITH
+    PY_TARGET(CONCAT_STR) {
+        const Value &x = r[in->b], &y = r[in->c];
+        if (x.type == Value::T_STR && y.type == Value::T_STR) {
+            // `s = s + t` appends in place
+            Value &dst = r[in->a];
+            if (&dst == &x) dst.s += y.s;
+            else if (&dst == &y) dst.s.insert(0, x.s);
+            else {
+                dst.type = Value::T_STR;
+                dst.s.assign(x.s);
+                dst.s += y.s;
+            }
+            DISPATCH();
+        }
+        deopt(in);
+        r[in->a] = VAdd(x, y);
+        DISPATCH();
+    }
+    // Proven forms (RangeAnalysis): operands and results are small ints.
+#define RB_INT_ARITH(OP, CALC)                                                 \
+    PY_TARGET(OP##_INT) {                                                      \
+        setInt(r[in->a], smallOf(r[in->b]) CALC smallOf(r[in->c]));            \
+        DISPATCH();                                                            \
+    }                                                                          \
+    PY_TARGET(OP##K_INT) {                                                     \
+        setInt(r[in->a], smallOf(r[in->b]) CALC smallOf(k[in->c]));            \
+        DISPATCH();                                                            \
+    }
+    RB_INT_ARITH(ADD, +)
+    RB_INT_ARITH(SUB, -)
+    RB_INT_ARITH(MUL, *)
+#undef RB_INT_ARITH
+    PY_TARGET(IDIVK_INT) {
+        setInt(r[in->a], floorDiv(smallOf(r[in->b]), smallOf(k[in->c])));
+        DISPATCH();
+    }
+    PY_TARGET(MODK_INT) {
+        setInt(r[in->a], floorMod(smallOf(r[in->b]), smallOf(k[in->c])));
+        DISPATCH();
+    }
+#define RB_INT_CMP_JMP(OP, CMP)                                                \
+    PY_TARGET(OP##_JMP_INT) {                                                  \
+        if (!(smallOf(r[in->a]) CMP smallOf(r[in->b]))) pc = code + in->c;     \
+        DISPATCH();                                                            \
+    }                                                                          \
+    PY_TARGET(OP##_JMPK_INT) {                                                 \
+        if (!(smallOf(r[in->a]) CMP smallOf(k[in->b]))) pc = code + in->c;     \
+        DISPATCH();                                                            \
+    }
+    RB_INT_CMP_JMP(LT, <)
+    RB_INT_CMP_JMP(GT, >)
+    RB_INT_CMP_JMP(EQ, ==)
+    RB_INT_CMP_JMP(GE, >=)
+    RB_INT_CMP_JMP(LE, <=)
+    RB_INT_CMP_JMP(NE, !=)
+#undef RB_INT_CMP_JMP
+    PY_TARGET(HALT) {
+        dispatches += n;
+        return;
+    }
+#ifndef PY_THREADED_DISPATCH
+        }
+    }
+#endif
+#undef DISPATCH
+}
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_REGISTERVM_H
+#define PYTHON_INTERPRETER_REGISTERVM_H
+
+#include <bits/stdc++.h>
+#include "RegisterBytecode.h"
+#include "Frames.h"
+#include "Memo.h"
+#include "RegisterJit.h"
+
+// Executes an rb::Chunk against a register file holding every variable and
+// temporary of the frame. A user-function call's window starts at the
+// caller's argument registers, so the arguments become the first locals.
+// Calls do not recurse natively: CALL saves the caller in `calls` and RET
+// resumes it, all inside one dispatch loop.
+//
+// Arithmetic and comparison instructions quicken: the VM runs a private copy
+// of the code, records the operand types each generic site sees and, once a
+// site has seen one kind kQuickenAfter times in a row, rewrites it into the
+// specialized op for that kind (rb::Op::ADD_SMALLINT and friends). A
+// specialized op whose guard fails deoptimizes back to the generic op for
+// good.
+class RegisterVM {
+public:
+    uint64_t dispatches = 0;
+    bool quicken = true;  // off with --no-quicken
+    uint64_t quickened = 0, deopts = 0;
+    // native tier for hot loops and functions (--jit); set up by run() when
+    // jit is on and RegisterJit::available()
+    bool jit = false;
+    uint32_t jitThreshold = 64;
+    std::unique_ptr<RegisterJit> native;
+    // one per executed def of a pure function (rb Function::pure)
+    std::deque<MemoTable> memos;
+
+    void run(const rb::Chunk &chunk);
+
+private:
+    // a def that has run, with the defaults it evaluated
+    struct BoundFunction {
+        const rb::Function *fn;
+        std::vector<Value> defaults;
+        MemoTable *memo; // null unless fn->pure
+    };
+    // binding cached by a call site for the function it last called
+    struct SiteCache {
+        const BoundFunction *fn = nullptr;
+        ArgBinding binding;
+    };
+    // where RET resumes the caller, and the register it stores the result in
+    struct CallFrame {
+        rb::Instr *pc;
+        Value *r;
+        int dst;
+        uint32_t memoBase; // this frame's slots in memoSlots start here
+    };
+
+    // operand types seen by a generic arithmetic or comparison instruction
+    struct Site {
+        rb::Op generic;     // the op to restore on deoptimization
+        uint8_t kind = 0;   // Kind in RegisterVM.cpp
+        uint8_t count = 0;  // executions that saw kind
+    };
+    static constexpr int kQuickenAfter = 8;
+
+    const rb::Chunk *chunk = nullptr;
+    std::vector<rb::Instr> text;  // chunk->code, rewritten by quickening
+    std::vector<Site> feedback;   // by instruction
+    std::vector<Value> regs; // module registers first, preallocated for kMaxCallDepth windows
+    std::deque<BoundFunction> bound;
+    std::vector<const BoundFunction *> functions; // by global register
+    std::vector<SiteCache> caches;                // by call site
+    std::vector<Value> scratch;                   // argument reordering
+    std::vector<CallFrame> calls;                 // reserved for kMaxCallDepth
+    // result slots of memoized calls still running; a frame owns several
+    // when it was reused by tail calls
+    std::vector<std::optional<Value> *> memoSlots;
+
+    // Runs the module code until HALT.
+    void execute();
+    // Stores result into the memo slots of the returning frame.
+    void settle(const Value &result, uint32_t base) {
+        for (size_t i = base; i < memoSlots.size(); ++i) *memoSlots[i] = result;
+        memoSlots.resize(base);
+    }
+    // Records the operands of the generic instruction in and quickens it
+    // once they have had one kind often enough.
+    void observe(rb::Instr *in, const Value &x, const Value &y);
+    // Turns the specialized instruction in back into its generic op.
+    void deopt(rb::Instr *in);
+    // Binds the argc arguments starting at args into the window of the
+    // function called through site and returns that function.
+    const BoundFunction &enter(int site, int argc, Value *args);
+};
+
+#endif//PYTHON_INTERPRETER_REGISTERVM_H
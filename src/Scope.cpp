@@ -0,0 +1,206 @@
+#include "Scope.h"
+
+namespace ast {
+
+// Calls f on every name a block assigns, without entering nested defs;
+// nested defs are reported to onDef.
+template <class F, class G> static void assignedNames(const Block &body, F &&f, G &&onDef) {
+    for (auto s : body) {
+        switch (s->kind) {
+            case Stmt::Assign:
+                for (auto &targets : static_cast<const AssignStmt *>(s)->targets)
+                    for (auto id : targets) f(id);
+                break;
+            case Stmt::AugAssign: f(static_cast<const AugAssignStmt *>(s)->target); break;
+            case Stmt::If: {
+                auto is = static_cast<const IfStmt *>(s);
+                for (auto &br : is->branches) assignedNames(br.body, f, onDef);
+                assignedNames(is->orelse, f, onDef);
+                break;
+            }
+            case Stmt::While: assignedNames(static_cast<const WhileStmt *>(s)->body, f, onDef); break;
+            case Stmt::FuncDef: onDef(static_cast<const FuncDefStmt *>(s)); break;
+            default: break;
+        }
+    }
+}
+
+static void functionNames(const FuncDefStmt *fn, NameSet &out) {
+    out.insert(fn->name);
+    assignedNames(fn->body, [](std::string_view) {}, [&](const FuncDefStmt *inner) { functionNames(inner, out); });
+}
+
+NameSet moduleBindings(const Block &body) {
+    NameSet names;
+    assignedNames(body, [&](std::string_view id) { names.insert(id); },
+                  [&](const FuncDefStmt *fn) { functionNames(fn, names); });
+    return names;
+}
+
+std::vector<std::string_view> functionLocals(const FuncDefStmt *fn, const NameSet &module) {
+    std::vector<std::string_view> locals;
+    for (auto &p : fn->params) locals.push_back(p.name);
+    assignedNames(fn->body, [&](std::string_view id) {
+        if (!module.count(id) && std::find(locals.begin(), locals.end(), id) == locals.end()) locals.push_back(id);
+    }, [](const FuncDefStmt *) {});
+    return locals;
+}
+
+bool callsFunction(const Expr *e) {
+    switch (e->kind) {
+        case Expr::Neg: case Expr::Not: return callsFunction(static_cast<const UnaryExpr *>(e)->operand);
+        case Expr::Binary: {
+            auto be = static_cast<const BinaryExpr *>(e);
+            return callsFunction(be->lhs) || callsFunction(be->rhs);
+        }
+        case Expr::Compare:
+            for (auto o : static_cast<const CompareExpr *>(e)->operands)
+                if (callsFunction(o)) return true;
+            return false;
+        case Expr::And: case Expr::Or:
+            for (auto o : static_cast<const LogicExpr *>(e)->operands)
+                if (callsFunction(o)) return true;
+            return false;
+        case Expr::Call: {
+            auto ce = static_cast<const CallExpr *>(e);
+            if (builtinByName(ce->callee) == Builtin::None) return true;
+            for (auto &arg : ce->args)
+                if (callsFunction(arg.value)) return true;
+            return false;
+        }
+        case Expr::FString:
+            for (auto &part : static_cast<const FStringExpr *>(e)->parts)
+                if (part.expr && callsFunction(part.expr)) return true;
+            return false;
+        case Expr::Tuple:
+            for (auto o : static_cast<const TupleExpr *>(e)->elems)
+                if (callsFunction(o)) return true;
+            return false;
+        default: return false;
+    }
+}
+
+// Whether e reads only names in `locals` and never prints; the user
+// functions it calls are added to `callees`.
+static bool readsOnly(const Expr *e, const NameSet &locals, NameSet &callees) {
+    switch (e->kind) {
+        case Expr::Name: return locals.count(static_cast<const NameExpr *>(e)->id) > 0;
+        case Expr::Neg: case Expr::Not: return readsOnly(static_cast<const UnaryExpr *>(e)->operand, locals, callees);
+        case Expr::Binary: {
+            auto be = static_cast<const BinaryExpr *>(e);
+            return readsOnly(be->lhs, locals, callees) && readsOnly(be->rhs, locals, callees);
+        }
+        case Expr::Compare:
+            for (auto o : static_cast<const CompareExpr *>(e)->operands)
+                if (!readsOnly(o, locals, callees)) return false;
+            return true;
+        case Expr::And: case Expr::Or:
+            for (auto o : static_cast<const LogicExpr *>(e)->operands)
+                if (!readsOnly(o, locals, callees)) return false;
+            return true;
+        case Expr::Call: {
+            auto ce = static_cast<const CallExpr *>(e);
+            Builtin fn = builtinByName(ce->callee);
+            if (fn == Builtin::Print) return false;
+            if (fn == Builtin::None) callees.insert(ce->callee);
+            for (auto &arg : ce->args)
+                if (!readsOnly(arg.value, locals, callees)) return false;
+            return true;
+        }
+        case Expr::FString:
+            for (auto &part : static_cast<const FStringExpr *>(e)->parts)
+                if (part.expr && !readsOnly(part.expr, locals, callees)) return false;
+            return true;
+        case Expr::Tuple:
+            for (auto o : static_cast<const TupleExpr *>(e)->elems)
+                if (!readsOnly(o, locals, callees)) return false;
+            return true;
+        default: return true;
+    }
+}
+
+static bool writesOnly(const Block &body, const NameSet &locals, NameSet &callees) {
+    for (auto s : body) {
+        switch (s->kind) {
+            case Stmt::ExprS:
+                if (!readsOnly(static_cast<const ExprStmt *>(s)->expr, locals, callees)) return false;
+                break;
+            case Stmt::Assign: {
+                auto as = static_cast<const AssignStmt *>(s);
+                for (auto &targets : as->targets)
+                    for (auto id : targets)
+                        if (!locals.count(id)) return false;
+                if (!readsOnly(as->value, locals, callees)) return false;
+                break;
+            }
+            case Stmt::AugAssign: {
+                auto as = static_cast<const AugAssignStmt *>(s);
+                if (!locals.count(as->target) || !readsOnly(as->value, locals, callees)) return false;
+                break;
+            }
+            case Stmt::If: {
+                auto is = static_cast<const IfStmt *>(s);
+                for (auto &br : is->branches)
+                    if (!readsOnly(br.cond, locals, callees) || !writesOnly(br.body, locals, callees)) return false;
+                if (!writesOnly(is->orelse, locals, callees)) return false;
+                break;
+            }
+            case Stmt::While: {
+                auto ws = static_cast<const WhileStmt *>(s);
+                if (!readsOnly(ws->cond, locals, callees) || !writesOnly(ws->body, locals, callees)) return false;
+                break;
+            }
+            case Stmt::Return: {
+                auto rs = static_cast<const ReturnStmt *>(s);
+                if (rs->value && !readsOnly(rs->value, locals, callees)) return false;
+                break;
+            }
+            case Stmt::FuncDef: return false;
+            default: break;
+        }
+    }
+    return true;
+}
+
+static void allDefs(const Block &body, std::vector<const FuncDefStmt *> &out) {
+    assignedNames(body, [](std::string_view) {}, [&](const FuncDefStmt *fn) {
+        out.push_back(fn);
+        allDefs(fn->body, out);
+    });
+}
+
+NameSet pureFunctions(const Block &module) {
+    std::vector<const FuncDefStmt *> defs;
+    allDefs(module, defs);
+    std::unordered_map<std::string_view, int> bindings;
+    for (auto fn : defs) ++bindings[fn->name];
+    NameSet moduleNames = moduleBindings(module);
+    // optimistically pure, then drop defs that call a non-pure one until stable
+    std::unordered_map<std::string_view, NameSet> callees;
+    NameSet pure;
+    for (auto fn : defs) {
+        if (bindings[fn->name] != 1) continue;
+        auto names = functionLocals(fn, moduleNames);
+        NameSet locals(names.begin(), names.end());
+        NameSet calls;
+        if (!writesOnly(fn->body, locals, calls)) continue;
+        pure.insert(fn->name);
+        callees.emplace(fn->name, std::move(calls));
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto it = pure.begin(); it != pure.end();) {
+            bool ok = true;
+            for (auto callee : callees[*it]) ok = ok && pure.count(callee);
+            if (ok) {
+                ++it;
+            } else {
+                it = pure.erase(it);
+                changed = true;
+            }
+        }
+    }
+    return pure;
+}
+
+} // namespace ast
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_SCOPE_H
+#define PYTHON_INTERPRETER_SCOPE_H
+
+#include <bits/stdc++.h>
+#include "Ast.h"
+
+// Scope rules (docs/grammar.md §12): globals are visible in every function
+// without `global`, so a name is local to a function only if it is one of its
+// parameters or it is assigned there and never bound at module level.
+namespace ast {
+
+using NameSet = std::unordered_set<std::string_view>;
+
+// Names assigned at module level (outside any def), plus every function name.
+NameSet moduleBindings(const Block &body);
+
+// A function's local slots: its parameters in order, then the other names it
+// assigns that are not in `module`, in order of first assignment.
+std::vector<std::string_view> functionLocals(const FuncDefStmt *fn, const NameSet &module);
+
+// Whether evaluating e may run a user function, which can rebind globals.
+bool callsFunction(const Expr *e);
+
+// Names of the defs whose result depends only on their arguments: the body
+// reads nothing but its locals, assigns no global, defines no function, never
+// prints, and calls only builtins and other such defs. Names that more than
+// one def binds are never included.
+NameSet pureFunctions(const Block &module);
+
+} // namespace ast
+
+#endif//PYTHON_INTERPRETER_SCOPE_H
@@ -0,0 +1,102 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_SMALLINT_H
+#define PYTHON_INTERPRETER_SMALLINT_H
+
+#include <bits/stdc++.h>
+#include "Value.h"
+
+// In-place fast paths shared by the register VM's specialized ops, the
+// JIT's runtime helpers and programs translated by --emit-cpp. Value has no
+// unboxed int: a small int is a T_INT of one base-1e9 limb, and results are
+// written into the destination's limb buffer instead of building a new BigInt.
+
+// an int of one limb, which fits a long long with room for any product
+inline bool isSmall(const Value &v) { return v.type == Value::T_INT && v.i.d.size() == 1; }
+inline long long smallOf(const Value &v) { return v.i.neg ? -(long long)v.i.d[0] : v.i.d[0]; }
+
+// Stores x into v, reusing v's limb buffer.
+inline void setSmall(Value &v, long long x) {
+    v.type = Value::T_INT;
+    v.i.neg = x < 0;
+    unsigned long long u = x < 0 ? -(unsigned long long)x : x;
+    if (u < unsigned(BigInt::BASE)) {
+        v.i.d.resize(1);
+        v.i.d[0] = int(u);
+        return;
+    }
+    v.i.d.clear();
+    for (; u; u /= BigInt::BASE) v.i.d.push_back(int(u % BigInt::BASE));
+}
+
+// setSmall for an x already known to fit one limb (RangeAnalysis)
+inline void setInt(Value &v, long long x) {
+    v.type = Value::T_INT;
+    v.i.neg = x < 0;
+    v.i.d.resize(1);
+    v.i.d[0] = int(x < 0 ? -x : x);
+}
+
+inline void setFloat(Value &v, double x) {
+    v.type = Value::T_FLOAT;
+    v.f = x;
+}
+
+inline void setBool(Value &v, bool x) {
+    v.type = Value::T_BOOL;
+    v.b = x;
+}
+
+// Python's floor division and modulo; b != 0
+inline long long floorDiv(long long a, long long b) {
+    long long q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+inline long long floorMod(long long a, long long b) {
+    long long m = a % b;
+    return (m != 0 && (m < 0) != (b < 0)) ? m + b : m;
+}
+
+// dst = x op y, in place when both are small ints or floats (or for str +=)
+template <BinOp OP>
+inline void arith(Value &dst, const Value &x, const Value &y) {
+    constexpr bool divides = OP == BinOp::IDiv || OP == BinOp::Mod;
+    if (OP != BinOp::Div && isSmall(x) && isSmall(y) && (!divides || !y.i.isZero())) {
+        long long a = smallOf(x), b = smallOf(y);
+        switch (OP) {
+            case BinOp::Add: setSmall(dst, a + b); return;
+            case BinOp::Sub: setSmall(dst, a - b); return;
+            case BinOp::Mul: setSmall(dst, a * b); return;
+            case BinOp::IDiv: setSmall(dst, floorDiv(a, b)); return;
+            default: setSmall(dst, floorMod(a, b)); return;
+        }
+    }
+    if (!divides && x.type == Value::T_FLOAT && y.type == Value::T_FLOAT) {
+        switch (OP) {
+            case BinOp::Add: setFloat(dst, x.f + y.f); return;
+            case BinOp::Sub: setFloat(dst, x.f - y.f); return;
+            case BinOp::Mul: setFloat(dst, x.f * y.f); return;
+            default: setFloat(dst, x.f / y.f); return;
+        }
+    }
+    if (OP == BinOp::Add && &dst == &x && x.type == Value::T_STR && y.type == Value::T_STR) {
+        dst.s += y.s;
+        return;
+    }
+    dst = VBinary(OP, x, y);
+}
+
+template <CmpOp OP>
+inline bool compare(const Value &x, const Value &y) {
+    if (!isSmall(x) || !isSmall(y)) return VCompare(OP, x, y);
+    long long a = smallOf(x), b = smallOf(y);
+    switch (OP) {
+        case CmpOp::Lt: return a < b;
+        case CmpOp::Gt: return a > b;
+        case CmpOp::Eq: return a == b;
+        case CmpOp::Ge: return a >= b;
+        case CmpOp::Le: return a <= b;
+        default: return a != b;
+    }
+}
+
+#endif//PYTHON_INTERPRETER_SMALLINT_H
@@ -0,0 +1,263 @@
+#include "StackVM.h"
+#include "Dispatch.h"
+
+using bc::Op;
+
+void StackVM::run(const bc::Chunk &program) {
+    chunk = &program;
+    globals.assign(program.names.size(), Value::None());
+    functions.assign(program.names.size(), nullptr);
+    caches.assign(program.sites.size(), SiteCache());
+    size_t frame = 0, params = 0;
+    for (auto &fn : program.functions) {
+        frame = std::max(frame, fn.locals.size() + fn.maxStack);
+        params = std::max(params, fn.params.size());
+    }
+    stack.assign(program.maxStack + 1 + frame * kMaxCallDepth, Value());
+    scratch.assign(params, Value());
+    calls.clear();
+    calls.reserve(kMaxCallDepth);
+    memoSlots.clear();
+    execute();
+}
+
+const StackVM::BoundFunction &StackVM::enter(int site, int argc, Value *sp) {
+    static const Value none;
+    const BoundFunction *callee = functions[chunk->sites[site].nameIndex];
+    if (!callee) throw std::runtime_error("'" + chunk->names[chunk->sites[site].nameIndex] + "' is not a function");
+    SiteCache &cache = caches[site];
+    if (cache.fn != callee) {
+        cache.binding = bindArguments(callee->fn->name, callee->fn->params, callee->defaults.size(), chunk->sites[site].keywords);
+        cache.fn = callee;
+    }
+    const bc::Function &fn = *callee->fn;
+    Value *fp = sp - argc;
+    const ArgBinding &binding = cache.binding;
+    if (!binding.inOrder) {
+        for (int i = 0; i < argc; ++i) scratch[i] = std::move(fp[i]);
+        for (int i = 0; i < argc; ++i) fp[binding.slotOfArg[i]] = std::move(scratch[i]);
+        size_t firstDefault = fn.params.size() - callee->defaults.size();
+        for (int p : binding.fromDefault) fp[p] = callee->defaults[p - firstDefault];
+    }
+    for (size_t i = fn.params.size(); i < fn.locals.size(); ++i) fp[i] = none;
+    return *callee;
+}
+
+void StackVM::execute() {
+    const bc::Chunk &chunk = *this->chunk;
+    Value *vars = globals.data();
+    const bc::Instr *code = chunk.code.data();
+    const bc::Instr *pc = code;
+    Value *fp = stack.data(), *sp = fp;
+    const bc::Instr *in;
+    uint64_t n = 0;
+#ifdef PY_THREADED_DISPATCH
+    static void *const dispatchTable[] = { BC_OPCODES(PY_LABEL_ADDR) };
+#define DISPATCH() do { in = pc++; ++n; goto *dispatchTable[int(in->op)]; } while (0)
+    DISPATCH();
+#else
+#define DISPATCH() continue
+    for (;;) {
+        in = pc++;
+        ++n;
+        switch (in->op) {
+#endif
+    PY_TARGET(LOAD_CONST) {
+        *sp++ = chunk.consts[in->a];
+        DISPATCH();
+    }
+    PY_TARGET(LOAD_NAME) {
+        *sp++ = vars[in->a];
+        DISPATCH();
+    }
+    PY_TARGET(STORE_NAME) {
+        vars[in->a] = std::move(*--sp);
+        DISPATCH();
+    }
+    PY_TARGET(LOAD_FAST) {
+        *sp++ = fp[in->a];
+        DISPATCH();
+    }
+    PY_TARGET(STORE_FAST) {
+        fp[in->a] = std::move(*--sp);
+        DISPATCH();
+    }
+    PY_TARGET(POP) {
+        --sp;
+        DISPATCH();
+    }
+    PY_TARGET(DUP) {
+        *sp = sp[-1]; ++sp;
+        DISPATCH();
+    }
+    PY_TARGET(ROT2) {
+        std::swap(sp[-1], sp[-2]);
+        DISPATCH();
+    }
+    PY_TARGET(ROT3) {
+        Value top = std::move(sp[-1]);
+        sp[-1] = std::move(sp[-2]);
+        sp[-2] = std::move(sp[-3]);
+        sp[-3] = std::move(top);
+        DISPATCH();
+    }
+    PY_TARGET(ADD) {
+        sp[-2] = VAdd(sp[-2], sp[-1]); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(SUB) {
+        sp[-2] = VSub(sp[-2], sp[-1]); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(MUL) {
+        sp[-2] = VMul(sp[-2], sp[-1]); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(DIV) {
+        sp[-2] = VDivFloat(sp[-2], sp[-1]); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(IDIV) {
+        sp[-2] = VDivInt(sp[-2], sp[-1]); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(MOD) {
+        sp[-2] = VMod(sp[-2], sp[-1]); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(NEG) {
+        sp[-1] = VNeg(sp[-1]);
+        DISPATCH();
+    }
+    PY_TARGET(NOT) {
+        sp[-1] = Value::fromBool(!sp[-1].truthy());
+        DISPATCH();
+    }
+    PY_TARGET(LT) {
+        sp[-2] = Value::fromBool(VCompare(CmpOp::Lt, sp[-2], sp[-1])); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(GT) {
+        sp[-2] = Value::fromBool(VCompare(CmpOp::Gt, sp[-2], sp[-1])); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(EQ) {
+        sp[-2] = Value::fromBool(VCompare(CmpOp::Eq, sp[-2], sp[-1])); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(GE) {
+        sp[-2] = Value::fromBool(VCompare(CmpOp::Ge, sp[-2], sp[-1])); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(LE) {
+        sp[-2] = Value::fromBool(VCompare(CmpOp::Le, sp[-2], sp[-1])); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(NE) {
+        sp[-2] = Value::fromBool(VCompare(CmpOp::Ne, sp[-2], sp[-1])); --sp;
+        DISPATCH();
+    }
+    PY_TARGET(JUMP) {
+        pc = code + in->a;
+        DISPATCH();
+    }
+    PY_TARGET(POP_JUMP_IF_FALSE) {
+        if (!(--sp)->truthy()) pc = code + in->a;
+        DISPATCH();
+    }
+    PY_TARGET(JUMP_IF_FALSE_OR_POP) {
+        if (!sp[-1].truthy()) pc = code + in->a; else --sp;
+        DISPATCH();
+    }
+    PY_TARGET(JUMP_IF_TRUE_OR_POP) {
+        if (sp[-1].truthy()) pc = code + in->a; else --sp;
+        DISPATCH();
+    }
+    PY_TARGET(CALL_BUILTIN) {
+        sp -= in->b;
+        Value r = VCallBuiltin(Builtin(in->a), sp, in->b);
+        *sp++ = std::move(r);
+        DISPATCH();
+    }
+    PY_TARGET(FORMAT) {
+        std::string out;
+        for (Value *v = sp - in->a; v < sp; ++v) v->appendTo(out);
+        sp -= in->a;
+        *sp++ = Value::fromStr(out);
+        DISPATCH();
+    }
+    PY_TARGET(MAKE_FUNCTION) {
+        const bc::Function &fn = chunk.functions[in->a];
+        MemoTable *memo = fn.pure ? &memos.emplace_back(fn.name) : nullptr;
+        BoundFunction &b = bound.emplace_back(BoundFunction{&fn, {}, memo});
+        for (Value *v = sp - in->b; v < sp; ++v) b.defaults.push_back(std::move(*v));
+        sp -= in->b;
+        functions[fn.nameIndex] = &b;
+        DISPATCH();
+    }
+    PY_TARGET(CALL) {
+        if (calls.size() >= size_t(kMaxCallDepth)) throw std::runtime_error("maximum recursion depth exceeded");
+        const BoundFunction &callee = enter(in->a, in->b, sp);
+        const bc::Function &fn = *callee.fn;
+        uint32_t memoBase = memoSlots.size();
+        if (callee.memo) {
+            auto [slot, hit] = callee.memo->lookup(sp - in->b, fn.params.size());
+            if (hit) {
+                sp -= in->b;
+                *sp++ = **slot;
+                DISPATCH();
+            }
+            if (slot) memoSlots.push_back(slot);
+        }
+        calls.push_back(CallFrame{pc, fp, memoBase});
+        fp = sp - in->b;
+        sp = fp + fn.locals.size();
+        pc = code + fn.entry;
+        DISPATCH();
+    }
+    PY_TARGET(TAIL_CALL) {
+        // the arguments replace the current frame, so the call depth stays put;
+        // swapping keeps the old values' buffers for the slots above to reuse
+        Value *args = sp - in->b;
+        if (args != fp)
+            for (int i = 0; i < in->b; ++i) std::swap(fp[i], args[i]);
+        const BoundFunction &callee = enter(in->a, in->b, fp + in->b);
+        const bc::Function &fn = *callee.fn;
+        if (callee.memo) {
+            auto [slot, hit] = callee.memo->lookup(fp, fn.params.size());
+            if (hit) {
+                // the current frame returns the cached result
+                *fp = **slot;
+                settle(*fp, calls.back().memoBase);
+                sp = fp + 1;
+                pc = calls.back().pc;
+                fp = calls.back().fp;
+                calls.pop_back();
+                DISPATCH();
+            }
+            if (slot) memoSlots.push_back(slot);
+        }
+        sp = fp + fn.locals.size();
+        pc = code + fn.entry;
+        DISPATCH();
+    }
+    PY_TARGET(RETURN_VALUE) {
+        // the result replaces the callee's frame on the caller's stack
+        if (sp - 1 != fp) *fp = std::move(sp[-1]);
+        if (memoSlots.size() > calls.back().memoBase) settle(*fp, calls.back().memoBase);
+        sp = fp + 1;
+        pc = calls.back().pc;
+        fp = calls.back().fp;
+        calls.pop_back();
+        DISPATCH();
+    }
+    PY_TARGET(HALT) {
+        dispatches += n;
+        return;
+    }
+#ifndef PY_THREADED_DISPATCH
+        }
+    }
+#endif
+#undef DISPATCH
+}
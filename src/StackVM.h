@@ -0,0 +1,67 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_STACKVM_H
+#define PYTHON_INTERPRETER_STACKVM_H
+
+#include <bits/stdc++.h>
+#include "Bytecode.h"
+#include "Frames.h"
+#include "Memo.h"
+
+// Executes a bc::Chunk with an explicit value stack instead of recursing
+// through visit() calls. A user-function call's frame sits on the same stack:
+// its arguments, pushed by the caller, become the first locals. Calls do not
+// recurse natively either: CALL saves the caller's pc and frame in `calls`
+// and RETURN_VALUE restores them, all inside one dispatch loop.
+class StackVM {
+public:
+    // global slots, indexed like chunk.names
+    std::vector<Value> globals;
+    uint64_t dispatches = 0;
+    // one per executed def of a pure function (bc Function::pure)
+    std::deque<MemoTable> memos;
+
+    void run(const bc::Chunk &chunk);
+
+private:
+    // a def that has run, with the defaults it evaluated
+    struct BoundFunction {
+        const bc::Function *fn;
+        std::vector<Value> defaults;
+        MemoTable *memo; // null unless fn->pure
+    };
+    // binding cached by a call site for the function it last called
+    struct SiteCache {
+        const BoundFunction *fn = nullptr;
+        ArgBinding binding;
+    };
+    // where RETURN_VALUE resumes the caller
+    struct CallFrame {
+        const bc::Instr *pc;
+        Value *fp;
+        uint32_t memoBase; // this frame's slots in memoSlots start here
+    };
+
+    const bc::Chunk *chunk = nullptr;
+    std::vector<Value> stack; // preallocated for kMaxCallDepth frames
+    std::deque<BoundFunction> bound;
+    std::vector<const BoundFunction *> functions; // by global slot
+    std::vector<SiteCache> caches;                // by call site
+    std::vector<Value> scratch;                   // argument reordering
+    std::vector<CallFrame> calls;                 // reserved for kMaxCallDepth
+    // result slots of memoized calls still running; a frame owns several
+    // when it was reused by tail calls
+    std::vector<std::optional<Value> *> memoSlots;
+
+    // Runs the module code until HALT.
+    void execute();
+    // Stores result into the memo slots of the returning frame.
+    void settle(const Value &result, uint32_t base) {
+        for (size_t i = base; i < memoSlots.size(); ++i) *memoSlots[i] = result;
+        memoSlots.resize(base);
+    }
+    // Binds the argc arguments on top of sp into the frame of the function
+    // called through site and returns that function.
+    const BoundFunction &enter(int site, int argc, Value *sp);
+};
+
+#endif//PYTHON_INTERPRETER_STACKVM_H
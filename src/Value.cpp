@@ -0,0 +1,162 @@
+#include "Value.h"
+#include "Output.h"
+
+char *formatFloat(double x, char *buf) {
+    // to_chars rounds the exact binary value like glibc's printf, and
+    // -0.0, inf and nan come out as printf spells them
+    return std::to_chars(buf, buf + kFloatChars, x, std::chars_format::fixed, 6).ptr;
+}
+
+static double toDouble(const Value &v) {
+    if (v.type == Value::T_FLOAT) return v.f;
+    if (v.type == Value::T_INT) return std::stod(v.i.toString());
+    if (v.type == Value::T_BOOL) return v.b ? 1.0 : 0.0;
+    return 0.0;
+}
+
+static BigInt toBigInt(const Value &v) {
+    if (v.type == Value::T_INT) return v.i;
+    return BigInt::fromLL(v.type == Value::T_BOOL && v.b ? 1 : 0);
+}
+
+static bool applyCmp(CmpOp op, int c) {
+    switch (op) {
+        case CmpOp::Lt: return c < 0;
+        case CmpOp::Gt: return c > 0;
+        case CmpOp::Eq: return c == 0;
+        case CmpOp::Ge: return c >= 0;
+        case CmpOp::Le: return c <= 0;
+        case CmpOp::Ne: return c != 0;
+    }
+    return false;
+}
+
+Value VAdd(const Value &a, const Value &b) {
+    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(a.i + b.i);
+    if (a.type == Value::T_FLOAT && b.type == Value::T_FLOAT) return Value::fromFloat(a.f + b.f);
+    if (a.type == Value::T_INT && b.type == Value::T_FLOAT) return Value::fromFloat(std::stod(a.i.toString()) + b.f);
+    if (a.type == Value::T_FLOAT && b.type == Value::T_INT) return Value::fromFloat(a.f + std::stod(b.i.toString()));
+    if (a.type == Value::T_STR && b.type == Value::T_STR) return Value::fromStr(a.s + b.s);
+    return Value::None();
+}
+Value VSub(const Value &a, const Value &b) {
+    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(a.i - b.i);
+    if (a.type == Value::T_FLOAT && b.type == Value::T_FLOAT) return Value::fromFloat(a.f - b.f);
+    if (a.type == Value::T_INT && b.type == Value::T_FLOAT) return Value::fromFloat(std::stod(a.i.toString()) - b.f);
+    if (a.type == Value::T_FLOAT && b.type == Value::T_INT) return Value::fromFloat(a.f - std::stod(b.i.toString()));
+    return Value::None();
+}
+Value VMul(const Value &a, const Value &b) {
+    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(a.i * b.i);
+    if (a.type == Value::T_FLOAT && b.type == Value::T_FLOAT) return Value::fromFloat(a.f * b.f);
+    if (a.type == Value::T_INT && b.type == Value::T_FLOAT) return Value::fromFloat(std::stod(a.i.toString()) * b.f);
+    if (a.type == Value::T_FLOAT && b.type == Value::T_INT) return Value::fromFloat(a.f * std::stod(b.i.toString()));
+    if (a.type == Value::T_STR && b.type == Value::T_INT) {
+        long long times = std::stoll(b.i.toString()); if (times < 0) times = 0;
+        std::string out; out.reserve(times * a.s.size());
+        for (long long i=0;i<times;++i) out += a.s;
+        return Value::fromStr(out);
+    }
+    return Value::None();
+}
+Value VDivInt(const Value &a, const Value &b) {
+    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(divFloor(a.i, b.i));
+    return Value::None();
+}
+Value VDivFloat(const Value &a, const Value &b) {
+    double x=0.0,y=0.0; bool ok=true;
+    if (a.type == Value::T_FLOAT) x=a.f; else if (a.type == Value::T_INT) x = std::stod(a.i.toString()); else ok=false;
+    if (b.type == Value::T_FLOAT) y=b.f; else if (b.type == Value::T_INT) y = std::stod(b.i.toString()); else ok=false;
+    if (!ok) return Value::None();
+    return Value::fromFloat(x / y);
+}
+Value VMod(const Value &a, const Value &b) {
+    if (a.type == Value::T_INT && b.type == Value::T_INT) return Value::fromInt(modFloor(a.i, b.i));
+    return Value::None();
+}
+
+Value VBinary(BinOp op, const Value &a, const Value &b) {
+    switch (op) {
+        case BinOp::Add: return VAdd(a, b);
+        case BinOp::Sub: return VSub(a, b);
+        case BinOp::Mul: return VMul(a, b);
+        case BinOp::Div: return VDivFloat(a, b);
+        case BinOp::IDiv: return VDivInt(a, b);
+        case BinOp::Mod: return VMod(a, b);
+    }
+    return Value::None();
+}
+
+Value VNeg(const Value &v) {
+    if (v.type == Value::T_INT) { BigInt t = v.i; t.neg = !t.neg; t.trim(); return Value::fromInt(t); }
+    if (v.type == Value::T_FLOAT) return Value::fromFloat(-v.f);
+    return v;
+}
+
+bool VCompare(CmpOp op, const Value &A, const Value &B) {
+    if (op == CmpOp::Eq || op == CmpOp::Ne) {
+        bool eq;
+        if (A.type == Value::T_STR || B.type == Value::T_STR) {
+            eq = A.type == Value::T_STR && B.type == Value::T_STR && A.s == B.s;
+        } else if (A.type == Value::T_NONE || B.type == Value::T_NONE) {
+            eq = A.type == Value::T_NONE && B.type == Value::T_NONE;
+        } else if (A.type == Value::T_FLOAT || B.type == Value::T_FLOAT) {
+            eq = toDouble(A) == toDouble(B);
+        } else {
+            eq = cmp(toBigInt(A), toBigInt(B)) == 0;
+        }
+        return op == CmpOp::Eq ? eq : !eq;
+    }
+    if (A.type == Value::T_STR || B.type == Value::T_STR) {
+        if (A.type != Value::T_STR || B.type != Value::T_STR) return false;
+        return applyCmp(op, A.s.compare(B.s));
+    }
+    if (A.type == Value::T_FLOAT || B.type == Value::T_FLOAT) {
+        double a = toDouble(A), b = toDouble(B);
+        return applyCmp(op, a < b ? -1 : (a > b ? 1 : 0));
+    }
+    return applyCmp(op, cmp(toBigInt(A), toBigInt(B)));
+}
+
+Builtin builtinByName(std::string_view name) {
+    if (name == "print") return Builtin::Print;
+    if (name == "int") return Builtin::Int;
+    if (name == "float") return Builtin::Float;
+    if (name == "str") return Builtin::Str;
+    if (name == "bool") return Builtin::Bool;
+    return Builtin::None;
+}
+
+Value VCallBuiltin(Builtin fn, const Value *args, size_t n) {
+    if (fn == Builtin::Print) {
+        Output &out = Output::standard();
+        for (size_t i=0;i<n;++i) {
+            if (i) out.put(' ');
+            out.put(args[i]);
+        }
+        out.put('\n');
+        return Value::None();
+    }
+    Value a = n ? args[0] : Value::None();
+    switch (fn) {
+        case Builtin::Int:
+            if (a.type == Value::T_INT) return a;
+            if (a.type == Value::T_BOOL) return Value::fromInt(a.b?BigInt::fromLL(1):BigInt::fromLL(0));
+            if (a.type == Value::T_FLOAT) return Value::fromInt(BigInt::fromLL((long long)a.f));
+            if (a.type == Value::T_STR) return Value::fromInt(BigInt::fromString(a.s));
+            return Value::fromInt(BigInt::fromLL(0));
+        case Builtin::Float:
+            if (a.type == Value::T_FLOAT) return a;
+            if (a.type == Value::T_INT) return Value::fromFloat(0.0 + std::stod(a.i.toString()));
+            if (a.type == Value::T_BOOL) return Value::fromFloat(a.b?1.0:0.0);
+            if (a.type == Value::T_STR) return Value::fromFloat(std::stod(a.s));
+            return Value::fromFloat(0.0);
+        case Builtin::Str:
+            if (a.type == Value::T_STR) return a;
+            return Value::fromStr(a.toString());
+        case Builtin::Bool:
+            return Value::fromBool(a.truthy());
+        default:
+            return Value::None();
+    }
+}
@@ -0,0 +1,256 @@
+#pragma once
+#ifndef PYTHON_INTERPRETER_VALUE_H
+#define PYTHON_INTERPRETER_VALUE_H
+
+#include <bits/stdc++.h>
+
+// Minimal BigInt implementation (base 1e9) to pass BigInteger tests
+struct BigInt {
+    static const int BASE = 1000000000;
+    std::vector<int> d; // little-endian blocks
+    bool neg = false;
+
+    BigInt() { d = {0}; }
+    BigInt(long long v) { *this = fromLL(v); }
+    static BigInt fromLL(long long v) {
+        BigInt x; x.d.clear(); if (v < 0) { x.neg = true; v = -v; }
+        while (v) { x.d.push_back(int(v % BASE)); v /= BASE; }
+        if (x.d.empty()) x.d.push_back(0), x.neg=false; return x;
+    }
+    static BigInt fromString(const std::string &s) {
+        BigInt x; x.d.clear(); size_t i = 0; if (!s.empty() && (s[0] == '-' || s[0] == '+')) { x.neg = (s[0]=='-'); i=1; }
+        std::vector<int> chunks; for (size_t j = s.size(); j > i; ) {
+            size_t k = (j >= i+9 ? j - 9 : i);
+            int block = 0;
+            for (size_t t = k; t < j; ++t) block = block*10 + (s[t]-'0');
+            chunks.push_back(block);
+            j = k;
+        }
+        if (chunks.empty()) chunks.push_back(0), x.neg=false;
+        x.d = chunks; // already little-endian
+        x.trim();
+        return x;
+    }
+    std::string toString() const {
+        if (isZero()) return "0";
+        std::string s = (neg?"-":"");
+        int n = d.size();
+        s += std::to_string(d.back());
+        for (int i = n-2; i>=0; --i) {
+            std::string t = std::to_string(d[i]);
+            s += std::string(9 - t.size(), '0') + t;
+        }
+        return s;
+    }
+    bool isZero() const { return d.size()==1 && d[0]==0; }
+    void trim() {
+        while (d.size() > 1 && d.back() == 0) d.pop_back();
+        if (isZero()) neg=false;
+    }
+    static int cmpAbs(const BigInt &a, const BigInt &b) {
+        if (a.d.size() != b.d.size()) return a.d.size() < b.d.size() ? -1 : 1;
+        for (int i = int(a.d.size())-1; i>=0; --i) if (a.d[i] != b.d[i]) return a.d[i] < b.d[i] ? -1 : 1;
+        return 0;
+    }
+    friend int cmp(const BigInt &a, const BigInt &b) {
+        if (a.neg != b.neg) return a.neg ? -1 : 1;
+        int c = cmpAbs(a,b);
+        return a.neg ? -c : c;
+    }
+    static BigInt addAbs(const BigInt &a, const BigInt &b) {
+        BigInt r; r.neg=false; r.d.assign(std::max(a.d.size(), b.d.size()), 0);
+        long long carry=0; for (size_t i=0;i<r.d.size();i++) {
+            long long sum = carry;
+            if (i < a.d.size()) sum += a.d[i];
+            if (i < b.d.size()) sum += b.d[i];
+            r.d[i] = int(sum % BASE);
+            carry = sum / BASE;
+        }
+        if (carry) r.d.push_back(int(carry));
+        return r;
+    }
+    static BigInt subAbs(const BigInt &a, const BigInt &b) { // assumes |a|>=|b|
+        BigInt r; r.neg=false; r.d.assign(a.d.size(),0);
+        long long carry=0; for (size_t i=0;i<a.d.size();++i) {
+            long long diff = (long long)a.d[i] - (i<b.d.size()?b.d[i]:0) - carry;
+            if (diff < 0) { diff += BASE; carry=1; } else carry=0;
+            r.d[i] = int(diff);
+        }
+        r.trim();
+        return r;
+    }
+    friend BigInt operator+(const BigInt &a, const BigInt &b) {
+        if (a.neg == b.neg) { BigInt r = addAbs(a,b); r.neg = a.neg; r.trim(); return r; }
+        int c = cmpAbs(a,b);
+        if (c==0) return BigInt::fromLL(0);
+        if (c>0) { BigInt r = subAbs(a,b); r.neg = a.neg; return r; }
+        BigInt r = subAbs(b,a); r.neg = b.neg; return r;
+    }
+    friend BigInt operator-(const BigInt &a, const BigInt &b) {
+        BigInt nb = b; nb.neg = !b.neg; return a + nb;
+    }
+    friend BigInt operator*(const BigInt &a, const BigInt &b) {
+        BigInt r; r.neg = a.neg ^ b.neg; r.d.assign(a.d.size()+b.d.size(), 0);
+        for (size_t i=0;i<a.d.size();++i) {
+            long long carry=0; for (size_t j=0;j<b.d.size();++j) {
+                long long cur = r.d[i+j] + (long long)a.d[i]*b.d[j] + carry;
+                r.d[i+j] = int(cur % BASE);
+                carry = cur / BASE;
+            }
+            size_t pos = i + b.d.size();
+            while (carry) {
+                long long cur = r.d[pos] + carry;
+                if (pos >= r.d.size()) r.d.push_back(0);
+                r.d[pos] = int(cur % BASE);
+                carry = cur / BASE;
+                ++pos;
+            }
+        }
+        r.trim();
+        return r;
+    }
+    static std::pair<BigInt, BigInt> divmodAbs(const BigInt &a, const BigInt &b) { // |b|>0, Knuth D
+        if (cmpAbs(a,b) < 0) return {fromLL(0), a.abs()};
+        if (b.d.size() == 1) {
+            long long div = b.d[0], rem = 0;
+            BigInt q; q.d.assign(a.d.size(), 0);
+            for (int i = int(a.d.size())-1; i>=0; --i) {
+                long long cur = a.d[i] + rem * BASE;
+                q.d[i] = int(cur / div); rem = cur % div;
+            }
+            q.trim();
+            return {q, fromLL(rem)};
+        }
+        int norm = BASE / (b.d.back() + 1);
+        BigInt A = a.abs() * fromLL(norm), B = b.abs() * fromLL(norm);
+        if (A.d.size() == a.d.size()) A.d.push_back(0);
+        int n = A.d.size(), m = B.d.size();
+        BigInt q; q.d.assign(n - m, 0);
+        for (int j = n - m - 1; j >= 0; --j) {
+            long long num = A.d[j+m] * 1LL * BASE + A.d[j+m-1];
+            long long qhat = num / B.d[m-1], rhat = num % B.d[m-1];
+            while (qhat >= BASE || qhat * B.d[m-2] > rhat * BASE + A.d[j+m-2]) {
+                --qhat; rhat += B.d[m-1];
+                if (rhat >= BASE) break;
+            }
+            long long carry = 0, borrow = 0;
+            for (int i = 0; i < m; ++i) {
+                long long p = qhat * B.d[i] + carry;
+                carry = p / BASE;
+                long long sub = A.d[i+j] - (p % BASE) - borrow;
+                if (sub < 0) { sub += BASE; borrow = 1; } else borrow = 0;
+                A.d[i+j] = int(sub);
+            }
+            long long top = A.d[j+m] - carry - borrow;
+            if (top < 0) { // qhat was one too large: add B back
+                --qhat;
+                long long c = 0;
+                for (int i = 0; i < m; ++i) {
+                    long long sum = A.d[i+j] + (long long)B.d[i] + c;
+                    if (sum >= BASE) { sum -= BASE; c = 1; } else c = 0;
+                    A.d[i+j] = int(sum);
+                }
+                top += c;
+            }
+            A.d[j+m] = int(top);
+            q.d[j] = int(qhat);
+        }
+        q.trim();
+        BigInt rr; rr.d.assign(A.d.begin(), A.d.begin() + m);
+        long long rem = 0;
+        for (int i = m-1; i>=0; --i) {
+            long long cur = rr.d[i] + rem * BASE;
+            rr.d[i] = int(cur / norm); rem = cur % norm;
+        }
+        rr.trim();
+        return {q, rr};
+    }
+    friend BigInt divFloor(const BigInt &a, const BigInt &b) { // a // b, floor division
+        if (b.isZero()) return fromLL(0); // avoid crash
+        bool neg = a.neg ^ b.neg;
+        auto ra = a.abs(); auto rb = b.abs();
+        auto [q, r] = divmodAbs(ra, rb);
+        q.neg = neg; q.trim();
+        if (!r.isZero() && neg) q = q - fromLL(1);
+        return q;
+    }
+    friend BigInt modFloor(const BigInt &a, const BigInt &b) { // a % b = a - (a // b) * b
+        BigInt q = divFloor(a,b);
+        BigInt r = a - q * b;
+        return r;
+    }
+    BigInt abs() const { BigInt r=*this; r.neg=false; return r; }
+};
+
+// Writes x the way print, str() and f-strings show a float (printf's "%.6f",
+// with "inf" and "nan" spelled the same) into buf and returns the end; buf
+// needs kFloatChars bytes, as -1.8e308 has 309 integer digits.
+constexpr size_t kFloatChars = 320;
+char *formatFloat(double x, char *buf);
+
+// A value variant used by visitor
+struct Value {
+    enum Type { T_INT, T_FLOAT, T_BOOL, T_STR, T_NONE } type = T_NONE;
+    BigInt i;
+    double f = 0.0;
+    bool b = false;
+    std::string s;
+    Value() : type(T_NONE) {}
+    static Value fromInt(const BigInt &x) { Value v; v.type=T_INT; v.i=x; return v; }
+    static Value fromFloat(double x) { Value v; v.type=T_FLOAT; v.f=x; return v; }
+    static Value fromBool(bool x) { Value v; v.type=T_BOOL; v.b=x; return v; }
+    static Value fromStr(const std::string &x) { Value v; v.type=T_STR; v.s=x; return v; }
+    static Value None() { return Value(); }
+    std::string toString() const {
+        switch (type) {
+            case T_INT: return i.toString();
+            case T_FLOAT: {
+                char buf[kFloatChars];
+                return std::string(buf, formatFloat(f, buf));
+            }
+            case T_BOOL: return b?"True":"False";
+            case T_STR: return s;
+            case T_NONE: return "None";
+        }
+        return "None";
+    }
+    // out += toString(), without the temporary for floats and strings (f-strings)
+    void appendTo(std::string &out) const {
+        if (type == T_STR) out += s;
+        else if (type == T_FLOAT) {
+            char buf[kFloatChars];
+            out.append(buf, formatFloat(f, buf));
+        } else out += toString();
+    }
+    bool truthy() const {
+        switch (type) {
+            case T_INT: return cmp(i, BigInt::fromLL(0)) != 0;
+            case T_FLOAT: return f != 0.0;
+            case T_BOOL: return b;
+            case T_STR: return !s.empty();
+            case T_NONE: return false;
+        }
+        return false;
+    }
+};
+
+// Operators shared by every execution engine
+enum class BinOp : uint8_t { Add, Sub, Mul, Div, IDiv, Mod };
+enum class CmpOp : uint8_t { Lt, Gt, Eq, Ge, Le, Ne };
+
+Value VAdd(const Value &a, const Value &b);
+Value VSub(const Value &a, const Value &b);
+Value VMul(const Value &a, const Value &b);
+Value VDivInt(const Value &a, const Value &b);
+Value VDivFloat(const Value &a, const Value &b);
+Value VMod(const Value &a, const Value &b);
+Value VBinary(BinOp op, const Value &a, const Value &b);
+Value VNeg(const Value &v);
+bool VCompare(CmpOp op, const Value &a, const Value &b);
+
+// Builtin functions; print writes to Output::standard()
+enum class Builtin : uint8_t { Print, Int, Float, Str, Bool, None };
+Builtin builtinByName(std::string_view name);
+Value VCallBuiltin(Builtin fn, const Value *args, size_t n);
+
+#endif//PYTHON_INTERPRETER_VALUE_H
@@ -1,12 +1,174 @@
 #include "Evalvisitor.h"
+#include "AstBuilder.h"
+#include "BytecodeCompiler.h"
+#include "StackVM.h"
+#include "RegisterCompiler.h"
+#include "RegisterVM.h"
+#include "ClosureEngine.h"
+#include "Optimizer.h"
+#include "RangeAnalysis.h"
+#include "CppEmitter.h"
+#include "Output.h"
+#include "Dispatch.h"
 #include "Python3Lexer.h"
 #include "Python3Parser.h"
 #include "antlr4-runtime.h"
 #include <iostream>
+#include <pthread.h>
 using namespace antlr4;
-// TODO: regenerating files in directory named "generated" is dangerous.
-//       if you really need to regenerate,please ask TA for help.
-int main(int argc, const char *argv[]) {
+
+// Parse stdin and lower it into an AST. The ANTLR objects (and with them the
+// parse tree) live only inside this function, so they are freed on return.
+static std::unique_ptr<ast::Program> lowerProgram(std::istream &in, bool report) {
+	ANTLRInputStream input(in);
+	Python3Lexer lexer(&input);
+	CommonTokenStream tokens(&lexer);
+	tokens.fill();
+	Python3Parser parser(&tokens);
+	auto *tree = parser.file_input();
+	auto program = std::make_unique<ast::Program>();
+	AstBuilder(*program).build(tree);
+	if (report) {
+		ParseTreeStats before = measureParseTree(tree);
+		std::cerr << "parse tree: " << before.nodes << " nodes, " << before.bytes << " bytes\n"
+		          << "ast:        " << program->nodeCount << " nodes, " << program->arena.bytesUsed()
+		          << " bytes (" << program->arena.bytesReserved() << " reserved)\n";
+	}
+	return program;
+}
+
+struct Options {
+	std::string engine = "visitor"; // visitor (reference) | vm | regvm | closure
+	bool astStats = false;
+	bool dumpBytecode = false;
+	bool stats = false; // dispatch count and execution time on stderr
+	bool tailCalls = true; // `return f(...)` reuses the caller's frame
+	bool memoize = false;  // VMs: cache results of pure functions, report hit rates
+	bool optimize = true;  // AST engines: constant folding and propagation
+	bool optRemarks = false; // what the optimizer rewrote, on stderr
+	bool quicken = true;   // regvm: specialize arithmetic on observed operand types
+	bool superinstructions = true; // regvm: fuse constant operands into loop idioms
+	bool jit = false;      // regvm: compile hot loops and functions to x86-64
+	uint32_t jitThreshold = 64; // calls or back edges before a unit is compiled
+	bool tierStats = false; // which loops and functions went native, on stderr
+	bool emitCpp = false;  // print the program as a standalone C++ translation unit instead of running it
+};
+
+static bool parseOptions(int argc, const char *argv[], Options &opt) {
+	bool engineGiven = false;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg.rfind("--engine=", 0) == 0) opt.engine = arg.substr(9), engineGiven = true;
+		else if (arg == "--ast-stats") opt.astStats = true;
+		else if (arg == "--dump-bytecode") opt.dumpBytecode = true;
+		else if (arg == "--stats") opt.stats = true;
+		else if (arg == "--no-tail-calls") opt.tailCalls = false;
+		else if (arg == "--memoize") opt.memoize = true;
+		else if (arg == "--no-opt") opt.optimize = false;
+		else if (arg == "--opt-remarks") opt.optRemarks = true;
+		else if (arg == "--no-quicken") opt.quicken = false;
+		else if (arg == "--no-superinstructions") opt.superinstructions = false;
+		else if (arg == "--jit") opt.jit = true;
+		else if (arg == "--tier-stats") opt.tierStats = true;
+		else if (arg == "--emit-cpp") opt.emitCpp = true;
+		else if (arg.rfind("--jit-threshold=", 0) == 0) opt.jitThreshold = std::max(1, std::atoi(arg.c_str() + 16));
+		else {
+			std::cerr << "unknown option " << arg << '\n';
+			return false;
+		}
+	}
+	if (opt.engine != "visitor" && opt.engine != "vm" && opt.engine != "regvm" && opt.engine != "closure") {
+		std::cerr << "unknown engine " << opt.engine << '\n';
+		return false;
+	}
+	// the translation runs nothing, so no engine option applies to it
+	if (opt.emitCpp && (engineGiven || opt.jit || opt.memoize || opt.stats || opt.dumpBytecode)) {
+		std::cerr << "--emit-cpp takes no --engine=, --jit, --memoize, --stats or --dump-bytecode\n";
+		return false;
+	}
+	if (opt.jit && opt.engine != "regvm") {
+		std::cerr << "--jit needs --engine=regvm\n";
+		return false;
+	}
+	if (opt.tierStats && !opt.jit) {
+		std::cerr << "--tier-stats needs --jit\n";
+		return false;
+	}
+	if (opt.jit && !RegisterJit::available()) {
+		std::cerr << "--jit is only supported on Linux x86-64\n";
+		return false;
+	}
+	if (opt.memoize && opt.engine != "vm" && opt.engine != "regvm") {
+		std::cerr << "--memoize needs --engine=vm or --engine=regvm\n";
+		return false;
+	}
+	return true;
+}
+
+// Runs fn and reports its wall-clock time together with the dispatch count it returns.
+template <class F> static void timed(const Options &opt, F &&fn) {
+	auto start = std::chrono::steady_clock::now();
+	uint64_t dispatches = fn();
+	Output::standard().flush();
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (opt.stats)
+		std::cerr << "engine=" << opt.engine << " dispatch=" << PY_DISPATCH_MODE << " dispatches=" << dispatches << " time_ms=" << ms << '\n';
+}
+
+static int execute(const Options &opt) {
+	if (opt.engine != "visitor" || opt.astStats || opt.emitCpp) {
+		auto program = lowerProgram(std::cin, opt.astStats);
+		if (opt.optimize && (opt.engine != "visitor" || opt.emitCpp)) {
+			Optimizer optimizer(*program);
+			if (opt.optRemarks) optimizer.remarks = &std::cerr;
+			optimizer.run();
+		}
+		if (opt.emitCpp) {
+			CppEmitter emitter;
+			emitter.tailCalls = opt.tailCalls;
+			emitter.emit(*program, std::cout);
+		} else if (opt.engine == "vm") {
+			BytecodeCompiler compiler;
+			compiler.tailCalls = opt.tailCalls;
+			compiler.memoize = opt.memoize;
+			bc::Chunk chunk = compiler.compile(*program);
+			program.reset();
+			if (opt.dumpBytecode) bc::disassemble(chunk, std::cerr);
+			StackVM vm;
+			timed(opt, [&] { vm.run(chunk); return vm.dispatches; });
+			if (opt.memoize) printMemoReport(vm.memos, std::cerr);
+		} else if (opt.engine == "regvm") {
+			RangeAnalysis ranges(*program);
+			if (opt.optRemarks) ranges.remarks = &std::cerr;
+			if (opt.optimize) ranges.run();
+			RegisterCompiler compiler;
+			compiler.tailCalls = opt.tailCalls;
+			compiler.memoize = opt.memoize;
+			compiler.superinstructions = opt.superinstructions;
+			if (opt.optimize) compiler.ranges = &ranges;
+			rb::Chunk chunk = compiler.compile(*program);
+			program.reset();
+			if (opt.dumpBytecode) rb::disassemble(chunk, std::cerr);
+			RegisterVM vm;
+			vm.quicken = opt.quicken;
+			vm.jit = opt.jit;
+			vm.jitThreshold = opt.jitThreshold;
+			timed(opt, [&] { vm.run(chunk); return vm.dispatches; });
+			if (opt.stats) std::cerr << "quicken: sites=" << vm.quickened << " deopts=" << vm.deopts << '\n';
+			if (opt.stats && vm.native)
+				std::cerr << "jit: units=" << vm.native->compiled << " bytes=" << vm.native->bytes
+				          << " entries=" << vm.native->entries << '\n';
+			if (opt.tierStats) vm.native->report(std::cerr);
+			if (opt.memoize) printMemoReport(vm.memos, std::cerr);
+		} else if (opt.engine == "closure") {
+			ClosureEngine engine;
+			engine.tailCalls = opt.tailCalls;
+			engine.compile(*program);
+			program.reset();
+			timed(opt, [&] { engine.run(); return engine.dispatches; });
+		}
+		return 0;
+	}
 	// TODO: please don't modify the code below the construction of ifs if you want to use visitor mode
 	ANTLRInputStream input(std::cin);
 	Python3Lexer lexer(&input);
@@ -15,6 +177,51 @@ int main(int argc, const char *argv[]) {
 	Python3Parser parser(&tokens);
 	tree::ParseTree *tree = parser.file_input();
 	EvalVisitor visitor;
-	visitor.visit(tree);
+	visitor.tailCalls = opt.tailCalls;
+	timed(opt, [&] { visitor.visit(tree); return visitor.visits; });
 	return 0;
 }
+
+// Runs the program. A runtime error (recursion depth, argument binding, calling
+// a non-function) ends it with status 1 after the output so far, as in aot::run.
+static int run(const Options &opt) {
+	try {
+		return execute(opt);
+	} catch (const std::exception &e) {
+		Output::standard().flush();
+		std::cerr << "error: " << e.what() << '\n';
+		return 1;
+	}
+}
+
+// Tree-walking engines recurse natively once per Python call, so they run on
+// a thread whose stack fits kMaxCallDepth frames. The VMs keep Python frames
+// in their own stacks and run on the main thread.
+static const size_t kInterpreterStack = size_t(512) << 20;
+
+struct RunArgs {
+	const Options *opt;
+	int status;
+};
+
+// TODO: regenerating files in directory named "generated" is dangerous.
+//       if you really need to regenerate,please ask TA for help.
+int main(int argc, const char *argv[]) {
+	Options opt;
+	if (!parseOptions(argc, argv, opt)) return 2;
+	if (opt.engine == "vm" || opt.engine == "regvm") return run(opt);
+	RunArgs args{&opt, 0};
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, kInterpreterStack);
+	pthread_t thread;
+	auto body = [](void *p) -> void * {
+		auto *a = static_cast<RunArgs *>(p);
+		a->status = run(*a->opt);
+		return nullptr;
+	};
+	if (pthread_create(&thread, &attr, body, &args) != 0) args.status = run(opt);
+	else pthread_join(thread, nullptr);
+	pthread_attr_destroy(&attr);
+	return args.status;
+}